@@ -0,0 +1,176 @@
+#include "red-black-lock-free.h"
+#include <sched.h>
+#include <thread>
+
+using namespace std;
+
+/******************************************************************************/
+/*                             CONTENTION MANAGEMENT                          */
+/******************************************************************************/
+/*   Every place a thread has to try again (a flag or key lock someone else   */
+/*   holds, a node a lookup saw change) waits through backoff_wait, which     */
+/*   pauses for an exponentially growing, randomly jittered number of spins  */
+/*   so retrying threads spread out instead of all hitting the same cache    */
+/*   line at once. Past a bounded number of attempts it yields the core       */
+/*   instead. Retries are counted per thread (on the slow path only) so the  */
+/*   settings can be tuned against contention_stats. The same records hold   */
+/*   each thread's TreeStats when the tree is built with TREE_STATS.          */
+/******************************************************************************/
+
+// Spinning only helps if the holder can run at the same time, on a single core
+// every wait yields straight away
+static ContentionManager_t default_manager() {
+  unsigned int yield_after = thread::hardware_concurrency() > 1 ? 6 : 0;
+  return {8, 512, yield_after};
+}
+
+static ContentionManager_t manager = default_manager();
+
+// Per-thread retry counters, padded to its own cache line. Only the owner
+// writes them, contention_stats reads them from any thread.
+typedef struct alignas(64) ContentionRecord {
+  atomic<uint64_t> retries;
+  atomic<uint64_t> yields;
+  atomic<uint64_t> max_attempts;
+  // Instrumentation, only counted into with TREE_STATS
+  TreeStats_t stats;
+  // Whether a live thread currently owns this record
+  atomic<bool> in_use;
+  struct ContentionRecord* next;
+} *ContentionRecord_t;
+
+static atomic<ContentionRecord_t> contention_records(nullptr);
+
+// The thread's record and its jitter state, the record is released when the
+// thread exits (its counts stay until the next reset)
+struct ContentionThread {
+  ContentionRecord_t record = nullptr;
+  uint32_t random = 0;
+  ~ContentionThread() {
+    if (record) record->in_use.store(false, memory_order_release);
+  }
+};
+static thread_local ContentionThread contention_thread;
+
+// Returns the calling thread's record, claiming a free one (or adding a new one)
+// on first use
+static ContentionRecord_t contention_record() {
+  if (contention_thread.record) return contention_thread.record;
+
+  for (ContentionRecord_t record = contention_records.load(); record; record = record->next) {
+    bool expected = false;
+    if (!record->in_use.load() && record->in_use.compare_exchange_strong(expected, true)) {
+      contention_thread.record = record;
+      return record;
+    }
+  }
+
+  ContentionRecord_t record = new struct ContentionRecord();
+  record->in_use = true;
+  record->next = contention_records.load();
+  while (!contention_records.compare_exchange_weak(record->next, record));
+  contention_thread.record = record;
+  return record;
+}
+
+// Adds delta to a counter only the calling thread writes
+static inline void count(atomic<uint64_t> &counter, uint64_t delta) {
+  counter.store(counter.load(memory_order_relaxed) + delta, memory_order_relaxed);
+}
+
+// Waits before the next attempt of backoff, longer the more attempts it took
+void backoff_wait(Backoff_t &backoff) {
+  ContentionRecord_t record = contention_record();
+  unsigned int attempts = ++backoff.attempts;
+  count(record->retries, 1);
+  if (attempts > record->max_attempts.load(memory_order_relaxed)) {
+    record->max_attempts.store(attempts, memory_order_relaxed);
+  }
+
+  if (attempts > manager.yield_after) {
+    count(record->yields, 1);
+    TREE_STAT(spin_iterations, 1);
+    sched_yield();
+    return;
+  }
+
+  unsigned int limit = manager.min_pause;
+  for (unsigned int i = 1; i < attempts && limit < manager.max_pause; i++) {
+    limit *= 2;
+  }
+  limit = min(limit, manager.max_pause);
+  // xorshift32, seeded differently in every thread
+  uint32_t &random = contention_thread.random;
+  if (!random) random = (uint32_t)(uintptr_t)record | 1;
+  random ^= random << 13;
+  random ^= random >> 17;
+  random ^= random << 5;
+  unsigned int pause = limit / 2 + random % (limit / 2 + 1);
+  for (unsigned int i = 0; i < pause; i++) {
+    cpu_relax();
+  }
+  TREE_STAT(spin_iterations, pause);
+}
+
+// Changes how threads back off from then on, call it while no tree is in use
+void contention_configure(ContentionManager_t new_manager) {
+  if (new_manager.min_pause == 0) new_manager.min_pause = 1;
+  if (new_manager.max_pause < new_manager.min_pause) new_manager.max_pause = new_manager.min_pause;
+  manager = new_manager;
+}
+
+ContentionManager_t contention_manager() {
+  return manager;
+}
+
+// Sums up the counters of every thread (an estimate while threads are running)
+ContentionStats_t contention_stats() {
+  ContentionStats_t stats = {0, 0, 0};
+  for (ContentionRecord_t record = contention_records.load(); record; record = record->next) {
+    stats.retries += record->retries.load(memory_order_relaxed);
+    stats.yields += record->yields.load(memory_order_relaxed);
+    stats.max_attempts = max(stats.max_attempts, record->max_attempts.load(memory_order_relaxed));
+  }
+  return stats;
+}
+
+// Zeroes every thread's counters, call it while no tree is in use
+void contention_reset_stats() {
+  for (ContentionRecord_t record = contention_records.load(); record; record = record->next) {
+    record->retries.store(0, memory_order_relaxed);
+    record->yields.store(0, memory_order_relaxed);
+    record->max_attempts.store(0, memory_order_relaxed);
+  }
+}
+
+// TreeStats is nothing but counters, summed and cleared one by one
+#define TREE_STATS_COUNTERS (sizeof(TreeStats_t) / sizeof(uint64_t))
+
+// Returns the calling thread's instrumentation counters
+TreeStats_t *tree_stats_claim() {
+  return &contention_record()->stats;
+}
+
+// Sums up the instrumentation counters of every thread (an estimate while
+// threads are running), all zero unless built with TREE_STATS
+TreeStats_t tree_stats() {
+  TreeStats_t stats = {};
+  uint64_t *total = (uint64_t *)&stats;
+  for (ContentionRecord_t record = contention_records.load(); record; record = record->next) {
+    uint64_t *counters = (uint64_t *)&record->stats;
+    for (size_t i = 0; i < TREE_STATS_COUNTERS; i++) {
+      total[i] += atomic_ref<uint64_t>(counters[i]).load(memory_order_relaxed);
+    }
+  }
+  return stats;
+}
+
+// Zeroes every thread's instrumentation counters, call it while no tree is in use
+void tree_stats_reset() {
+  for (ContentionRecord_t record = contention_records.load(); record; record = record->next) {
+    uint64_t *counters = (uint64_t *)&record->stats;
+    for (size_t i = 0; i < TREE_STATS_COUNTERS; i++) {
+      atomic_ref<uint64_t>(counters[i]).store(0, memory_order_relaxed);
+    }
+  }
+}
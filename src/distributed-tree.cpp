@@ -0,0 +1,217 @@
+#include "distributed-tree.h"
+#include <climits>
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+DistributedTree_t distributed_init(MPI_Comm comm, int min_key, int max_key, int num_threads, int batch_size,
+                                   bool use_node_pool) {
+  DistributedTree_t tree = new struct DistributedTree();
+  tree->comm = comm;
+  MPI_Comm_rank(comm, &tree->rank);
+  MPI_Comm_size(comm, &tree->num_ranks);
+  tree->shard = tree_init(use_node_pool);
+  tree->shard_size = 0;
+  tree->num_threads = num_threads;
+  tree->batch_size = batch_size;
+
+  // Until rebalanced, each rank owns an equal slice of [min_key, max_key]
+  int64_t width = (int64_t)max_key - min_key + 1;
+  tree->splitters.resize(tree->num_ranks);
+  tree->splitters[0] = INT_MIN;
+  for (int r = 1; r < tree->num_ranks; r++) {
+    tree->splitters[r] = min_key + width * r / tree->num_ranks;
+  }
+  return tree;
+}
+
+void distributed_free(DistributedTree_t &tree) {
+  tree_free(tree->shard, tree->num_threads);
+  delete tree;
+  tree = nullptr;
+}
+
+// Returns the rank holding key
+int distributed_owner(DistributedTree_t tree, int key) {
+  return upper_bound(tree->splitters.begin(), tree->splitters.end(), key) - tree->splitters.begin() - 1;
+}
+
+// Applies the operation to every key this rank was sent, returns how many succeeded
+static size_t apply_local(DistributedTree_t tree, const vector<int> &keys, int type, vector<char> &results) {
+  Tree shard = tree->shard;
+  int num_keys = keys.size();
+  size_t succeeded = 0;
+
+  int threads_needed = max(1, min(num_keys, tree->num_threads));
+  #pragma omp parallel for schedule(dynamic, tree->batch_size) num_threads(threads_needed) reduction(+:succeeded)
+  for (int i = 0; i < num_keys; i++) {
+    bool done;
+    if (type == INSERT) {
+      done = tree_insert(shard, keys[i]);
+    } else if (type == DELETE) {
+      done = tree_delete(shard, keys[i]);
+    } else {
+      done = tree_lookup(shard, keys[i]);
+    }
+    results[i] = done;
+    succeeded += done;
+  }
+
+  if (type == INSERT) tree->shard_size += succeeded;
+  if (type == DELETE) tree->shard_size -= succeeded;
+  return succeeded;
+}
+
+// Sends every key to its owner to apply the operation to, and fills results
+// (if given) in the order of keys. Returns how many of this rank's keys the
+// operation succeeded for.
+static size_t route(DistributedTree_t tree, span<const int> keys, int type, vector<bool> *results) {
+  int num_ranks = tree->num_ranks;
+  if (results) results->assign(keys.size(), false);
+
+  // Every rank takes part in as many exchanges as the one with the most keys needs
+  unsigned long long rounds = (keys.size() + DISTRIBUTED_ROUND - 1) / DISTRIBUTED_ROUND, all_rounds;
+  MPI_Allreduce(&rounds, &all_rounds, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, tree->comm);
+
+  vector<int> send_counts(num_ranks), send_displs(num_ranks), recv_counts(num_ranks), recv_displs(num_ranks);
+  vector<int> send_keys, recv_keys, owners, positions, next(num_ranks);
+  vector<char> send_results, recv_results;
+  size_t succeeded = 0;
+  for (unsigned long long round = 0; round < all_rounds; round++) {
+    size_t begin = min<size_t>(keys.size(), round * DISTRIBUTED_ROUND);
+    span<const int> batch = keys.subspan(begin, min(keys.size() - begin, (size_t)DISTRIBUTED_ROUND));
+    int num_keys = batch.size();
+
+    // Counting sort the batch by owner, remembering where each key went
+    fill(send_counts.begin(), send_counts.end(), 0);
+    owners.resize(num_keys);
+    for (int i = 0; i < num_keys; i++) {
+      owners[i] = distributed_owner(tree, batch[i]);
+      send_counts[owners[i]]++;
+    }
+    exclusive_scan(send_counts.begin(), send_counts.end(), send_displs.begin(), 0);
+    next = send_displs;
+    send_keys.resize(num_keys);
+    positions.resize(num_keys);
+    for (int i = 0; i < num_keys; i++) {
+      positions[i] = next[owners[i]]++;
+      send_keys[positions[i]] = batch[i];
+    }
+
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, tree->comm);
+    exclusive_scan(recv_counts.begin(), recv_counts.end(), recv_displs.begin(), 0);
+    int num_received = recv_displs.back() + recv_counts.back();
+    recv_keys.resize(num_received);
+    MPI_Alltoallv(send_keys.data(), send_counts.data(), send_displs.data(), MPI_INT, recv_keys.data(),
+                  recv_counts.data(), recv_displs.data(), MPI_INT, tree->comm);
+
+    recv_results.resize(num_received);
+    apply_local(tree, recv_keys, type, recv_results);
+
+    // Results go back along the same counts the other way
+    send_results.resize(num_keys);
+    MPI_Alltoallv(recv_results.data(), recv_counts.data(), recv_displs.data(), MPI_CHAR, send_results.data(),
+                  send_counts.data(), send_displs.data(), MPI_CHAR, tree->comm);
+    for (int i = 0; i < num_keys; i++) {
+      if (!send_results[positions[i]]) continue;
+      succeeded++;
+      if (results) (*results)[begin + i] = true;
+    }
+  }
+  return succeeded;
+}
+
+// Inserts every rank's keys, returns how many of this rank's keys weren't
+// already in the tree (results says which, if given)
+size_t distributed_insert(DistributedTree_t tree, span<const int> keys, vector<bool> *results) {
+  return route(tree, keys, INSERT, results);
+}
+
+// Deletes every rank's keys, returns how many of this rank's keys were in the tree
+size_t distributed_delete(DistributedTree_t tree, span<const int> keys, vector<bool> *results) {
+  return route(tree, keys, DELETE, results);
+}
+
+// Looks up every rank's keys, returns how many of this rank's keys were found
+size_t distributed_lookup(DistributedTree_t tree, span<const int> keys, vector<bool> *results) {
+  return route(tree, keys, LOOKUP, results);
+}
+
+// Returns the number of keys over all ranks
+size_t distributed_size(DistributedTree_t tree) {
+  unsigned long long size = tree->shard_size, total;
+  MPI_Allreduce(&size, &total, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, tree->comm);
+  return total;
+}
+
+// Returns the largest shard's size over the mean shard size (1 when perfectly
+// balanced, or empty)
+double distributed_skew(DistributedTree_t tree) {
+  unsigned long long size = tree->shard_size, largest, total;
+  MPI_Allreduce(&size, &largest, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, tree->comm);
+  MPI_Allreduce(&size, &total, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, tree->comm);
+  if (!total) return 1;
+  return (double)largest * tree->num_ranks / total;
+}
+
+// If distributed_skew is above max_skew, moves the splitters so every rank owns
+// the same number of keys (give or take one) and sends the keys that changed
+// owner to their new ranks. Returns the number of keys moved over all ranks.
+size_t distributed_rebalance(DistributedTree_t tree, double max_skew) {
+  if (distributed_skew(tree) <= max_skew) return 0;
+  int num_ranks = tree->num_ranks, rank = tree->rank;
+
+  vector<unsigned long long> sizes(num_ranks);
+  unsigned long long size = tree->shard_size;
+  MPI_Allgather(&size, 1, MPI_UNSIGNED_LONG_LONG, sizes.data(), 1, MPI_UNSIGNED_LONG_LONG, tree->comm);
+  unsigned long long first = accumulate(sizes.begin(), sizes.begin() + rank, 0ULL);
+  unsigned long long total = accumulate(sizes.begin() + rank, sizes.end(), first);
+
+  // The shards hold consecutive stretches of the set in key order, so the key
+  // at position i of the whole set is at position i - first of the shard holding
+  // it. Each rank fills in the new splitters that fall in its shard.
+  vector<pair<unsigned long long, int>> wanted;
+  for (int r = 1; r < num_ranks; r++) {
+    unsigned long long position = total * r / num_ranks;
+    if (position >= first && position < first + size) wanted.push_back({position - first, r});
+  }
+  vector<int> splitters(num_ranks, INT_MIN);
+  if (!wanted.empty()) {
+    size_t index = 0, next = 0;
+    tree_range(tree->shard, INT_MIN, INT_MAX, [&](int key, NoValue) {
+      while (next < wanted.size() && wanted[next].first == index) splitters[wanted[next++].second] = key;
+      index++;
+    });
+  }
+  MPI_Allreduce(MPI_IN_PLACE, splitters.data(), num_ranks, MPI_INT, MPI_MAX, tree->comm);
+
+  // Take out the keys this rank no longer owns and send them to their owners
+  vector<int> moving;
+  auto collect = [&](int key, NoValue) { moving.push_back(key); };
+  if (splitters[rank] > INT_MIN) tree_range(tree->shard, INT_MIN, splitters[rank] - 1, collect);
+  if (rank + 1 < num_ranks) tree_range(tree->shard, splitters[rank + 1], INT_MAX, collect);
+  tree_delete_bulk(tree->shard, moving, tree->batch_size, tree->num_threads);
+  tree->shard_size -= moving.size();
+  tree->splitters = splitters;
+  route(tree, moving, INSERT, nullptr);
+
+  unsigned long long moved = moving.size(), all_moved;
+  MPI_Allreduce(&moved, &all_moved, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, tree->comm);
+  return all_moved;
+}
+
+// Returns whether every shard is a valid tree holding only keys its rank owns
+bool distributed_validate(DistributedTree_t tree) {
+  int rank = tree->rank;
+  int lo = tree->splitters[rank];
+  bool last = rank + 1 == tree->num_ranks;
+  size_t outside = 0;
+  size_t visited = tree_range(tree->shard, INT_MIN, INT_MAX, [&](int key, NoValue) {
+    if (key < lo || (!last && key >= tree->splitters[rank + 1])) outside++;
+  });
+  int valid = tree_validate(tree->shard) && !outside && visited == tree->shard_size;
+  int all_valid;
+  MPI_Allreduce(&valid, &all_valid, 1, MPI_INT, MPI_LAND, tree->comm);
+  return all_valid;
+}
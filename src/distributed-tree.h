@@ -0,0 +1,60 @@
+#ifndef DISTRIBUTED_TREE_H
+#define DISTRIBUTED_TREE_H
+
+#include <mpi.h>
+#include <vector>
+#include <span>
+#include <stddef.h>
+#include "red-black-lock-free.h"
+
+using namespace std;
+
+/******************************************************************************/
+/*                          DISTRIBUTED TREE                                  */
+/******************************************************************************/
+/*   An int set spread over the ranks of an MPI communicator by key range:    */
+/*   rank r holds the keys in [splitters[r], splitters[r + 1]) in a lock-free  */
+/*   tree of its own (the last rank up to INT_MAX), so the set can grow past  */
+/*   one node's memory. Every function is collective: each rank passes its    */
+/*   own batch of keys, which are sorted by owner and exchanged with one      */
+/*   MPI_Alltoallv per round, applied by the owners' threads as a bulk        */
+/*   operation, and the results are sent back in the same order.              */
+/*   distributed_rebalance moves the splitters (and keys) when the shards'    */
+/*   sizes drift apart.                                                       */
+/******************************************************************************/
+
+// Most keys a rank sends out in one exchange, bounding the message buffers
+#define DISTRIBUTED_ROUND (1 << 20)
+
+typedef struct DistributedTree {
+  MPI_Comm comm;
+  int rank;
+  int num_ranks;
+  // This rank's keys
+  Tree shard;
+  // Number of keys in shard
+  size_t shard_size;
+  // splitters[r] is the smallest key rank r owns, splitters[0] is INT_MIN.
+  // Non-decreasing, the same on every rank.
+  vector<int> splitters;
+  // How each rank applies the keys it receives, as in tree_insert_bulk
+  int num_threads;
+  int batch_size;
+} *DistributedTree_t;
+
+// Distributed Tree Functions (collective over the tree's communicator)
+DistributedTree_t distributed_init(MPI_Comm comm, int min_key, int max_key, int num_threads, int batch_size = 8,
+                                   bool use_node_pool = false);
+void distributed_free(DistributedTree_t &tree);
+size_t distributed_insert(DistributedTree_t tree, span<const int> keys, vector<bool> *results = nullptr);
+size_t distributed_delete(DistributedTree_t tree, span<const int> keys, vector<bool> *results = nullptr);
+size_t distributed_lookup(DistributedTree_t tree, span<const int> keys, vector<bool> *results = nullptr);
+size_t distributed_size(DistributedTree_t tree);
+double distributed_skew(DistributedTree_t tree);
+size_t distributed_rebalance(DistributedTree_t tree, double max_skew);
+bool distributed_validate(DistributedTree_t tree);
+
+// Local (not collective)
+int distributed_owner(DistributedTree_t tree, int key);
+
+#endif
@@ -0,0 +1,31 @@
+#include "red-black-hand-over-hand.h"
+#include "engine.h"
+
+using namespace std;
+
+static void *hand_over_hand_create(int num_threads, int num_keys) {
+  (void)num_threads;
+  (void)num_keys;
+  return tree_init<int>();
+}
+
+static void hand_over_hand_destroy(void *tree, int num_threads) {
+  (void)num_threads;
+  HandOverHandTree_t t = (HandOverHandTree_t)tree;
+  tree_free(t);
+}
+
+static bool hand_over_hand_insert(void *tree, int key) {
+  return tree_insert((HandOverHandTree_t)tree, key);
+}
+
+static bool hand_over_hand_remove(void *tree, int key) {
+  return tree_delete((HandOverHandTree_t)tree, key);
+}
+
+static bool hand_over_hand_lookup(void *tree, int key) {
+  return tree_lookup((HandOverHandTree_t)tree, key);
+}
+
+const Engine_t hand_over_hand_engine = {"hand-over-hand", hand_over_hand_create, hand_over_hand_destroy,
+                                        hand_over_hand_insert, hand_over_hand_remove, hand_over_hand_lookup};
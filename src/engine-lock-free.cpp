@@ -0,0 +1,61 @@
+#include "red-black-lock-free.h"
+#include "sharded-tree.h"
+#include "engine.h"
+
+using namespace std;
+
+static void *lock_free_create(int num_threads, int num_keys) {
+  (void)num_threads;
+  (void)num_keys;
+  return tree_init(true);
+}
+
+static void lock_free_destroy(void *tree, int num_threads) {
+  Tree t = (Tree)tree;
+  tree_free(t, num_threads);
+}
+
+static bool lock_free_insert(void *tree, int key) {
+  Tree t = (Tree)tree;
+  return tree_insert(t, key);
+}
+
+static bool lock_free_remove(void *tree, int key) {
+  Tree t = (Tree)tree;
+  return tree_delete(t, key);
+}
+
+static bool lock_free_lookup(void *tree, int key) {
+  Tree t = (Tree)tree;
+  return tree_lookup(t, key);
+}
+
+const Engine_t lock_free_engine = {"lock-free", lock_free_create, lock_free_destroy, lock_free_insert,
+                                   lock_free_remove, lock_free_lookup};
+
+static void *sharded_lock_free_create(int num_threads, int num_keys) {
+  (void)num_threads;
+  return sharded_init<Tree>(engine_splitters(ENGINE_SHARDS, num_keys), false, [] { return tree_init(true); });
+}
+
+static void sharded_lock_free_destroy(void *tree, int num_threads) {
+  (void)num_threads;
+  ShardedTree<Tree> *sharded = (ShardedTree<Tree> *)tree;
+  sharded_free(sharded);
+}
+
+static bool sharded_lock_free_insert(void *tree, int key) {
+  return sharded_insert((ShardedTree<Tree> *)tree, key);
+}
+
+static bool sharded_lock_free_remove(void *tree, int key) {
+  return sharded_delete((ShardedTree<Tree> *)tree, key);
+}
+
+static bool sharded_lock_free_lookup(void *tree, int key) {
+  return sharded_lookup((ShardedTree<Tree> *)tree, key);
+}
+
+const Engine_t sharded_lock_free_engine = {"sharded-lock-free", sharded_lock_free_create, sharded_lock_free_destroy,
+                                           sharded_lock_free_insert, sharded_lock_free_remove,
+                                           sharded_lock_free_lookup};
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <memory>
+#include <vector>
+#include <string>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include "node-pool.h"
+#include "tree-common.h"
+#include "frozen-tree.h"
+#include "engine.h"
+
+// The sequential tree's types and functions share their names with the
+// lock-free tree's, which the same program links in too, so they're compiled
+// into a namespace of their own here (the headers it includes are already in)
+namespace sequential {
+#include "red-black-sequential.h"
+}
+#include "sharded-tree.h"
+#include "flat-combining.h"
+
+using namespace std;
+
+// The sequential tree and the mutex every operation on it holds
+typedef struct LockedTree {
+  sequential::Tree tree;
+  mutex lock;
+} LockedTree_t;
+
+static void *sequential_create(int num_threads, int num_keys) {
+  (void)num_threads;
+  (void)num_keys;
+  LockedTree_t *locked = new LockedTree_t();
+  locked->tree = sequential::tree_init(true);
+  return locked;
+}
+
+static void sequential_destroy(void *tree, int num_threads) {
+  (void)num_threads;
+  LockedTree_t *locked = (LockedTree_t *)tree;
+  sequential::tree_free(locked->tree);
+  delete locked;
+}
+
+static bool sequential_insert(void *tree, int key) {
+  LockedTree_t *locked = (LockedTree_t *)tree;
+  lock_guard<mutex> guard(locked->lock);
+  return sequential::tree_insert(locked->tree, key);
+}
+
+static bool sequential_remove(void *tree, int key) {
+  LockedTree_t *locked = (LockedTree_t *)tree;
+  lock_guard<mutex> guard(locked->lock);
+  return sequential::tree_delete(locked->tree, key);
+}
+
+static bool sequential_lookup(void *tree, int key) {
+  LockedTree_t *locked = (LockedTree_t *)tree;
+  lock_guard<mutex> guard(locked->lock);
+  return sequential::tree_lookup(locked->tree, key);
+}
+
+const Engine_t sequential_engine = {"sequential", sequential_create, sequential_destroy, sequential_insert,
+                                    sequential_remove, sequential_lookup};
+
+// The sequential tree behind one reader-writer lock, so lookups (which don't
+// change the tree) run side by side and only wait for inserts and deletes
+typedef struct SharedTree {
+  sequential::Tree tree;
+  shared_mutex lock;
+} SharedTree_t;
+
+static void *rwlock_create(int num_threads, int num_keys) {
+  (void)num_threads;
+  (void)num_keys;
+  SharedTree_t *shared = new SharedTree_t();
+  shared->tree = sequential::tree_init(true);
+  return shared;
+}
+
+static void rwlock_destroy(void *tree, int num_threads) {
+  (void)num_threads;
+  SharedTree_t *shared = (SharedTree_t *)tree;
+  sequential::tree_free(shared->tree);
+  delete shared;
+}
+
+static bool rwlock_insert(void *tree, int key) {
+  SharedTree_t *shared = (SharedTree_t *)tree;
+  unique_lock<shared_mutex> guard(shared->lock);
+  return sequential::tree_insert(shared->tree, key);
+}
+
+static bool rwlock_remove(void *tree, int key) {
+  SharedTree_t *shared = (SharedTree_t *)tree;
+  unique_lock<shared_mutex> guard(shared->lock);
+  return sequential::tree_delete(shared->tree, key);
+}
+
+static bool rwlock_lookup(void *tree, int key) {
+  SharedTree_t *shared = (SharedTree_t *)tree;
+  shared_lock<shared_mutex> guard(shared->lock);
+  return sequential::tree_lookup(shared->tree, key);
+}
+
+const Engine_t rwlock_engine = {"rwlock", rwlock_create, rwlock_destroy, rwlock_insert, rwlock_remove,
+                                rwlock_lookup};
+
+// Shards are locked one by one, so threads only wait for others in the same shard
+typedef ShardedTree<sequential::Tree> *ShardedSequential;
+
+static void *sharded_sequential_create(int num_threads, int num_keys) {
+  (void)num_threads;
+  return sharded_init<sequential::Tree>(engine_splitters(ENGINE_SHARDS, num_keys), true,
+                                        [] { return sequential::tree_init(true); });
+}
+
+static void sharded_sequential_destroy(void *tree, int num_threads) {
+  (void)num_threads;
+  ShardedSequential sharded = (ShardedSequential)tree;
+  sharded_free(sharded);
+}
+
+static bool sharded_sequential_insert(void *tree, int key) {
+  return sharded_insert((ShardedSequential)tree, key);
+}
+
+static bool sharded_sequential_remove(void *tree, int key) {
+  return sharded_delete((ShardedSequential)tree, key);
+}
+
+static bool sharded_sequential_lookup(void *tree, int key) {
+  return sharded_lookup((ShardedSequential)tree, key);
+}
+
+const Engine_t sharded_sequential_engine = {"sharded-sequential", sharded_sequential_create,
+                                            sharded_sequential_destroy, sharded_sequential_insert,
+                                            sharded_sequential_remove, sharded_sequential_lookup};
+
+// Threads hand their operations to whichever of them holds the combiner lock
+typedef CombiningTree<sequential::Tree> *Combining;
+
+static void *combining_create(int num_threads, int num_keys) {
+  (void)num_threads;
+  (void)num_keys;
+  return combining_init(sequential::tree_init(true));
+}
+
+static void combining_destroy(void *tree, int num_threads) {
+  (void)num_threads;
+  Combining combining = (Combining)tree;
+  combining_free(combining);
+}
+
+static bool combining_engine_insert(void *tree, int key) {
+  return combining_insert((Combining)tree, key);
+}
+
+static bool combining_engine_remove(void *tree, int key) {
+  return combining_delete((Combining)tree, key);
+}
+
+static bool combining_engine_lookup(void *tree, int key) {
+  return combining_lookup((Combining)tree, key);
+}
+
+const Engine_t combining_engine = {"combining", combining_create, combining_destroy, combining_engine_insert,
+                                   combining_engine_remove, combining_engine_lookup};
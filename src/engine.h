@@ -0,0 +1,50 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <vector>
+
+using namespace std;
+
+// A tree implementation the benchmark harness (red-black-bench.cpp) can drive
+// from any number of threads at once through int keys. Each engine lives in a
+// translation unit of its own, as the trees' headers use the same names and
+// can't be included together.
+typedef struct Engine {
+  const char *name;
+  // Makes an empty tree to be used by up to num_threads threads, for keys
+  // 0..num_keys-1 (which only engines splitting the key space need to know)
+  void *(*create)(int num_threads, int num_keys);
+  void (*destroy)(void *tree, int num_threads);
+  bool (*insert)(void *tree, int key);
+  bool (*remove)(void *tree, int key);
+  bool (*lookup)(void *tree, int key);
+} Engine_t;
+
+// The sequential tree behind one mutex (engine-sequential.cpp)
+extern const Engine_t sequential_engine;
+// The sequential tree behind one reader-writer lock (engine-sequential.cpp)
+extern const Engine_t rwlock_engine;
+// The top-down tree with a mutex per node, locked hand over hand
+// (engine-hand-over-hand.cpp, see red-black-hand-over-hand.h)
+extern const Engine_t hand_over_hand_engine;
+// The lock-free tree (engine-lock-free.cpp)
+extern const Engine_t lock_free_engine;
+// ENGINE_SHARDS sequential trees, each behind its own mutex, and ENGINE_SHARDS
+// lock-free trees splitting the keys evenly (see sharded-tree.h)
+extern const Engine_t sharded_sequential_engine;
+extern const Engine_t sharded_lock_free_engine;
+// The sequential tree under flat combining (engine-sequential.cpp, see flat-combining.h)
+extern const Engine_t combining_engine;
+
+#define ENGINE_SHARDS 64
+
+// Splitters giving each of num_shards shards as many of the keys 0..num_keys-1
+inline vector<int> engine_splitters(int num_shards, int num_keys) {
+  vector<int> splitters;
+  for (int s = 1; s < num_shards; s++) {
+    splitters.push_back((long long)num_keys * s / num_shards);
+  }
+  return splitters;
+}
+
+#endif
@@ -0,0 +1,152 @@
+#include "red-black-lock-free.h"
+
+using namespace std;
+
+/******************************************************************************/
+/*                          EPOCH-BASED MEMORY RECLAMATION                    */
+/******************************************************************************/
+/*   A node unlinked by tree_delete may still be referenced by another thread  */
+/*   that read a pointer to it before the unlink, so it is retired instead of  */
+/*   deleted. Every tree operation runs inside an epoch critical section and   */
+/*   announces the global epoch it started in. The global epoch only advances  */
+/*   once every active thread has caught up with it, so a node retired in      */
+/*   epoch e is unreachable by anyone once the global epoch reaches e + 2.     */
+/*   Each thread keeps its own retire list and frees it in batches.            */
+/******************************************************************************/
+
+// Number of retired nodes a thread collects before trying to free them
+#define EPOCH_RETIRE_THRESHOLD 128
+
+// A retired node, the epoch it was retired in and how to free it (the tree's
+// free_tree_node and the pool the node goes back to)
+typedef struct EpochRetired {
+  uint64_t epoch;
+  void *node;
+  void (*free_node)(NodePool_t, void *);
+  NodePool_t pool;
+} EpochRetired;
+
+// Per-thread epoch record, padded to its own cache line so announcing an epoch
+// doesn't invalidate other threads' records
+typedef struct alignas(64) EpochRecord {
+  // (epoch << 1) | 1 while inside a critical section, 0 otherwise
+  atomic<uint64_t> announced;
+  // Whether a live thread currently owns this record
+  atomic<bool> in_use;
+  // Critical section nesting depth (only touched by the owner)
+  int depth;
+  // Nodes retired by the owner, along with the epoch they were retired in
+  vector<EpochRetired> retired;
+  struct EpochRecord* next;
+} *EpochRecord_t;
+
+static atomic<uint64_t> global_epoch(0);
+static atomic<EpochRecord_t> epoch_records(nullptr);
+
+// Releases the thread's record when the thread exits, any nodes still on its
+// retire list are freed later by the next thread to claim the record
+struct EpochThread {
+  EpochRecord_t record = nullptr;
+  ~EpochThread() {
+    if (record) record->in_use.store(false, memory_order_release);
+  }
+};
+static thread_local EpochThread epoch_thread;
+
+// Returns the calling thread's record, claiming a free one (or adding a new one)
+// on first use
+static EpochRecord_t epoch_record() {
+  if (epoch_thread.record) return epoch_thread.record;
+
+  for (EpochRecord_t record = epoch_records.load(); record; record = record->next) {
+    bool expected = false;
+    if (!record->in_use.load() && record->in_use.compare_exchange_strong(expected, true)) {
+      epoch_thread.record = record;
+      return record;
+    }
+  }
+
+  EpochRecord_t record = new struct EpochRecord();
+  record->announced = 0;
+  record->in_use = true;
+  record->depth = 0;
+  record->next = epoch_records.load();
+  while (!epoch_records.compare_exchange_weak(record->next, record));
+  epoch_thread.record = record;
+  return record;
+}
+
+// Advance the global epoch if every thread inside a critical section has
+// announced the current one, returns the (possibly new) global epoch
+static uint64_t epoch_try_advance() {
+  atomic_thread_fence(memory_order_seq_cst);
+  uint64_t epoch = global_epoch.load();
+  for (EpochRecord_t record = epoch_records.load(); record; record = record->next) {
+    uint64_t announced = record->announced.load();
+    if ((announced & 1) && (announced >> 1) != epoch) {
+      return epoch;
+    }
+  }
+  global_epoch.compare_exchange_strong(epoch, epoch + 1);
+  return global_epoch.load();
+}
+
+// Free every node on the thread's retire list that no other thread can reach
+static void epoch_free_retired(EpochRecord_t record) {
+  uint64_t epoch = epoch_try_advance();
+  size_t kept = 0;
+  for (auto &retired : record->retired) {
+    if (retired.epoch + 2 <= epoch) {
+      retired.free_node(retired.pool, retired.node);
+      if (retired.pool) pool_release(retired.pool);
+    } else {
+      record->retired[kept++] = retired;
+    }
+  }
+  record->retired.resize(kept);
+}
+
+// Enter an epoch critical section, pointers to tree nodes read inside it stay
+// valid until the matching epoch_exit (sections may be nested)
+void epoch_enter() {
+  EpochRecord_t record = epoch_record();
+  if (record->depth++ > 0) return;
+  record->announced.store((global_epoch.load() << 1) | 1, memory_order_relaxed);
+  // Make the announcement visible before any node is read (pairs with the fence
+  // in epoch_try_advance)
+  atomic_thread_fence(memory_order_seq_cst);
+}
+
+// Leave an epoch critical section
+void epoch_exit() {
+  EpochRecord_t record = epoch_record();
+  if (--record->depth > 0) return;
+  record->announced.store(0, memory_order_release);
+}
+
+// Hand an unlinked node over to be freed once no thread can still reach it
+void epoch_retire(void *node, void (*free_node)(NodePool_t, void *), NodePool_t pool) {
+  EpochRecord_t record = epoch_record();
+  // The tree may be freed before the node is, its pool has to outlive it
+  if (pool) pool_retain(pool);
+  record->retired.push_back({global_epoch.load(), node, free_node, pool});
+  if (record->retired.size() >= EPOCH_RETIRE_THRESHOLD) {
+    epoch_free_retired(record);
+  }
+}
+
+// Free as much of the calling thread's retire list as possible, e.g. at the end
+// of a bulk operation
+void epoch_flush() {
+  EpochRecord_t record = epoch_record();
+  if (record->depth > 0) return;
+  // Each pass can advance the epoch at most once, two make the oldest nodes safe
+  for (int i = 0; i < 3 && !record->retired.empty(); i++) {
+    epoch_free_retired(record);
+  }
+}
+
+// Number of nodes retired by the calling thread that haven't been freed yet
+size_t epoch_pending() {
+  return epoch_record()->retired.size();
+}
@@ -1,47 +1,42 @@
 #!/bin/bash
+# Builds the release binaries and runs every test case in inputs and the
+# mixed workload benchmark over a range of thread counts, with OpenMP's threads
+# pinned one per core so runs don't migrate between cores (or share one).
+#
+#   ./exp.sh                   1 2 4 8 threads
+#   THREADS="1 2 4 8 16 32 64" ./exp.sh
+#   BUILD=profile ./exp.sh     run the profiling build (for perf record)
+#
+# OMP_PROC_BIND and OMP_PLACES can be overridden too, e.g. OMP_PLACES=threads
+# to also use the cores' hyperthreads.
 
-# For PSC:
+cd "$(dirname "$0")" || exit 1
 
-# module load openmpi
-# module avail openmpi
+BUILD=${BUILD:-release}
+THREADS=${THREADS:-"1 2 4 8"}
+BATCHSIZE=${BATCHSIZE:-8}
+BENCH_SECONDS=${BENCH_SECONDS:-1}
+export OMP_PROC_BIND=${OMP_PROC_BIND:-close}
+export OMP_PLACES=${OMP_PLACES:-cores}
 
-# mpic++ -Wall -Wextra -O3 -std=c++2a -fopenmp -o red-black-parallel red-black-lock-free-test.cpp red-black-lock-free.h red-black-lock-free.cpp
+make "$BUILD" || exit 1
+if [ "$BUILD" = release ]; then
+    BIN=.
+else
+    BIN=build/$BUILD
+fi
 
-# for TEST_CASE in basic bulk
-# do
-#     for OP in delete insert
-#     do
-#         for NUMTHREADS in 1 2 4 8
-#         do
-#             for BATCHSIZE in 8
-#             do 
-#                 echo "\n"
-#                 echo "Running with threads = $NUMTHREADS, batch size = $BATCHSIZE, ${TEST_CASE}_$OP\n"
-#                 mpirun -n $NUMTHREADS ./red-black-parallel -f ~/parallel-red-black-trees/src/inputs/${TEST_CASE}_$OP.txt -b $BATCHSIZE -n $NUMTHREADS
-#             done
-#         done 
-#     done
-# done
-
-# For 72-core Xeon Phi:
-# TODO
-
-# For GHC:
-mpic++ -Wall -Wextra -O3 -std=c++2a -fopenmp -o red-black-parallel red-black-lock-free-test.cpp red-black-lock-free.h red-black-lock-free.cpp
-
-for TEST_CASE in basic bulk
+echo "OMP_PROC_BIND=$OMP_PROC_BIND OMP_PLACES=$OMP_PLACES"
+for TEST_CASE in inputs/*
 do
-    for OP in insert
-    # for OP in delete insert
+    for NUMTHREADS in $THREADS
     do
-        for NUMTHREADS in 1 2 4 8
-        do
-            for BATCHSIZE in 8
-            do 
-                echo "\n"
-                echo "Running with threads = $NUMTHREADS, batch size = $BATCHSIZE, ${TEST_CASE}_$OP\n"
-                mpirun -n $NUMTHREADS ./red-black-parallel -f ~/private/15418/parallel-red-black-trees/src/inputs/${TEST_CASE}_$OP.txt -b $BATCHSIZE -n $NUMTHREADS
-            done
-        done 
+        echo
+        echo "Running with threads = $NUMTHREADS, batch size = $BATCHSIZE, $TEST_CASE"
+        "$BIN/red-black-parallel" -f "$TEST_CASE" -b "$BATCHSIZE" -n "$NUMTHREADS"
     done
-done
\ No newline at end of file
+done
+
+MAX_THREADS=$(echo $THREADS | tr ' ' '\n' | sort -n | tail -1)
+echo
+"$BIN/red-black-bench" -n "$MAX_THREADS" -t "$BENCH_SECONDS"
@@ -0,0 +1,227 @@
+#ifndef FLAT_COMBINING_H
+#define FLAT_COMBINING_H
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <stdint.h>
+#include "node-pool.h"
+#include "tree-common.h"
+
+using namespace std;
+
+/******************************************************************************/
+/*                            FLAT COMBINING                                  */
+/******************************************************************************/
+/*   Lets any number of threads share a tree that only one may use at a time  */
+/*   (Hendler, Incze, Shavit and Tzafrir, "Flat Combining and the             */
+/*   Synchronization-Parallelism Tradeoff"). Each thread publishes its        */
+/*   operation in a record of its own, then either takes the combiner lock or */
+/*   waits for its record to be answered. The combiner gathers every pending  */
+/*   request, sorts them by key and applies them one after the other, so the  */
+/*   tree is only ever touched by one thread at a time, its top levels stay   */
+/*   in that thread's cache, and neighbouring keys reuse each other's paths.  */
+/*   Include this after red-black-sequential.h and wrap its Tree.             */
+/******************************************************************************/
+
+// Pauses a waiting thread spins for before yielding its core
+#define COMBINING_SPINS 64
+
+// What a record holds: nothing, a request waiting to be applied, or an answer
+enum CombiningState {
+  COMBINING_IDLE,
+  COMBINING_INSERT,
+  COMBINING_DELETE,
+  COMBINING_LOOKUP,
+  COMBINING_DONE
+};
+
+// Key type of the wrapped tree, from its tree pointer type
+template <typename TreePtr>
+struct CombiningTraits;
+template <template <typename, typename, typename> class Tree, typename Key, typename Value, typename Compare>
+struct CombiningTraits<Tree<Key, Value, Compare> *> {
+  typedef Key KeyType;
+};
+
+// A thread's publication record, on a cache line of its own so publishing a
+// request only invalidates the combiner's copy
+template <typename Key>
+struct alignas(CACHE_LINE_SIZE) CombiningRecord {
+  // The owner stores its request (release) once key is set, the combiner
+  // stores COMBINING_DONE (release) once result is
+  atomic<int> state;
+  Key key;
+  bool result;
+  CombiningRecord *next;
+};
+
+template <typename TreePtr>
+struct CombiningTree {
+  typedef typename CombiningTraits<TreePtr>::KeyType Key;
+
+  TreePtr tree;
+  // Unique for the lifetime of the process, used to find a thread's record
+  uint64_t id;
+  // Every thread's record, newest first (records are only freed with the tree)
+  atomic<CombiningRecord<Key> *> records;
+  // Held by the combiner
+  alignas(CACHE_LINE_SIZE) atomic<bool> lock;
+  // Requests gathered in one pass, only touched by the combiner
+  vector<CombiningRecord<Key> *> batch;
+  // Passes made and requests applied by them, only touched by the combiner
+  uint64_t passes;
+  uint64_t combined;
+};
+
+inline atomic<uint64_t> next_combining_id(1);
+
+// Combining Functions
+template <typename TreePtr>
+CombiningTree<TreePtr> *combining_init(TreePtr tree);
+template <typename TreePtr>
+void combining_free(CombiningTree<TreePtr> *&combining);
+template <typename TreePtr>
+bool combining_insert(CombiningTree<TreePtr> *combining, const typename CombiningTree<TreePtr>::Key &key);
+template <typename TreePtr>
+bool combining_delete(CombiningTree<TreePtr> *combining, const typename CombiningTree<TreePtr>::Key &key);
+template <typename TreePtr>
+bool combining_lookup(CombiningTree<TreePtr> *combining, const typename CombiningTree<TreePtr>::Key &key);
+template <typename TreePtr>
+double combining_batch_size(CombiningTree<TreePtr> *combining);
+
+/******************************************************************************/
+/*                             DEFINITIONS                                    */
+/******************************************************************************/
+
+// Wraps tree, which the combining tree then owns (and frees)
+template <typename TreePtr>
+CombiningTree<TreePtr> *combining_init(TreePtr tree) {
+  CombiningTree<TreePtr> *combining = new CombiningTree<TreePtr>();
+  combining->tree = tree;
+  combining->id = next_combining_id++;
+  combining->records = nullptr;
+  combining->lock = false;
+  combining->passes = 0;
+  combining->combined = 0;
+  return combining;
+}
+
+// Frees the tree and every record, no thread may be using it
+template <typename TreePtr>
+void combining_free(CombiningTree<TreePtr> *&combining) {
+  CombiningRecord<typename CombiningTree<TreePtr>::Key> *record = combining->records.load();
+  while (record) {
+    auto next = record->next;
+    delete record;
+    record = next;
+  }
+  tree_free(combining->tree);
+  delete combining;
+  combining = nullptr;
+}
+
+// Returns the calling thread's record in combining, adding it on first use
+template <typename TreePtr>
+CombiningRecord<typename CombiningTree<TreePtr>::Key> *combining_record(CombiningTree<TreePtr> *combining) {
+  typedef CombiningRecord<typename CombiningTree<TreePtr>::Key> Record;
+  // Records this thread has in each combining tree it has used, with the last
+  // one cached since a thread almost always works on one tree at a time
+  static thread_local vector<pair<uint64_t, Record *>> thread_records;
+  static thread_local pair<uint64_t, Record *> last_record = {0, nullptr};
+  if (last_record.first == combining->id) return last_record.second;
+
+  Record *record = nullptr;
+  for (auto &entry : thread_records) {
+    if (entry.first == combining->id) {
+      record = entry.second;
+      break;
+    }
+  }
+  if (!record) {
+    record = new Record();
+    record->state = COMBINING_IDLE;
+    record->next = combining->records.load();
+    while (!combining->records.compare_exchange_weak(record->next, record));
+    thread_records.push_back({combining->id, record});
+  }
+  last_record = {combining->id, record};
+  return record;
+}
+
+// Applies every pending request, in key order. Only called holding the lock.
+template <typename TreePtr>
+void combine(CombiningTree<TreePtr> *combining) {
+  auto &batch = combining->batch;
+  batch.clear();
+  for (auto record = combining->records.load(memory_order_acquire); record; record = record->next) {
+    int state = record->state.load(memory_order_acquire);
+    if (state != COMBINING_IDLE && state != COMBINING_DONE) batch.push_back(record);
+  }
+  sort(batch.begin(), batch.end(), [&](auto a, auto b) { return combining->tree->compare(a->key, b->key); });
+
+  for (auto record : batch) {
+    int state = record->state.load(memory_order_relaxed);
+    if (state == COMBINING_INSERT) {
+      record->result = tree_insert(combining->tree, record->key);
+    } else if (state == COMBINING_DELETE) {
+      record->result = tree_delete(combining->tree, record->key);
+    } else {
+      record->result = tree_lookup(combining->tree, record->key);
+    }
+    record->state.store(COMBINING_DONE, memory_order_release);
+  }
+  combining->passes++;
+  combining->combined += batch.size();
+}
+
+// Publishes the request and waits for its answer, combining whenever the lock
+// is free
+template <typename TreePtr>
+bool combining_apply(CombiningTree<TreePtr> *combining, int request, const typename CombiningTree<TreePtr>::Key &key) {
+  auto record = combining_record(combining);
+  record->key = key;
+  record->state.store(request, memory_order_release);
+
+  int spins = 0;
+  while (record->state.load(memory_order_acquire) != COMBINING_DONE) {
+    if (!combining->lock.load(memory_order_relaxed) && !combining->lock.exchange(true, memory_order_acquire)) {
+      // The request was published before the lock was taken, so this pass answers it
+      combine(combining);
+      combining->lock.store(false, memory_order_release);
+    } else if (++spins < COMBINING_SPINS) {
+      cpu_relax();
+    } else {
+      spins = 0;
+      this_thread::yield();
+    }
+  }
+  bool result = record->result;
+  record->state.store(COMBINING_IDLE, memory_order_relaxed);
+  return result;
+}
+
+template <typename TreePtr>
+bool combining_insert(CombiningTree<TreePtr> *combining, const typename CombiningTree<TreePtr>::Key &key) {
+  return combining_apply(combining, COMBINING_INSERT, key);
+}
+
+template <typename TreePtr>
+bool combining_delete(CombiningTree<TreePtr> *combining, const typename CombiningTree<TreePtr>::Key &key) {
+  return combining_apply(combining, COMBINING_DELETE, key);
+}
+
+template <typename TreePtr>
+bool combining_lookup(CombiningTree<TreePtr> *combining, const typename CombiningTree<TreePtr>::Key &key) {
+  return combining_apply(combining, COMBINING_LOOKUP, key);
+}
+
+// Average number of requests a combiner has applied per pass, no thread may be
+// using the tree
+template <typename TreePtr>
+double combining_batch_size(CombiningTree<TreePtr> *combining) {
+  return combining->passes ? (double)combining->combined / combining->passes : 0;
+}
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef FROZEN_TREE_H
+#define FROZEN_TREE_H
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <stdint.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#include "node-pool.h"
+#include "tree-common.h"
+
+using namespace std;
+
+// Read-only snapshot of a tree (see tree_freeze) for phases that only look keys
+// up. Keys sit in one array in Eytzinger order, the implicit binary tree heaps
+// use: the root at 1 and the children of k at 2k and 2k + 1. A search then walks
+// down one array with no pointers to chase, the top levels share a few cache
+// lines that stay hot, and the four levels below a node sit next to each other
+// where they can be prefetched ahead of the search.
+template <typename Key, typename Value = NoValue, typename Compare = less<Key>>
+struct FrozenTree {
+  // keys[0] is unused, so a search that falls off the left of every key ends at 0
+  vector<Key> keys;
+  // Value of keys[k] in values[k], left empty for sets
+  vector<Value> values;
+  size_t size;
+  [[no_unique_address]] Compare compare;
+};
+
+// Keys in one cache line, how far ahead of the search to prefetch (four levels
+// down for 4-byte keys)
+template <typename Key>
+constexpr size_t frozen_prefetch_stride() {
+  return max(CACHE_LINE_SIZE / sizeof(Key), (size_t)1);
+}
+
+// Lays sorted keys (and values) out in Eytzinger order, visiting the implicit
+// tree at k in order
+template <typename Key, typename Value, typename Compare>
+void frozen_fill(FrozenTree<Key, Value, Compare> *frozen, vector<Key> &keys, vector<Value> &values, size_t &next,
+                 size_t k) {
+  if (k > frozen->size) return;
+  frozen_fill(frozen, keys, values, next, 2 * k);
+  frozen->keys[k] = std::move(keys[next]);
+  if (!frozen->values.empty() && !values.empty()) frozen->values[k] = std::move(values[next]);
+  next++;
+  frozen_fill(frozen, keys, values, next, 2 * k + 1);
+}
+
+// Builds a frozen tree from keys sorted and unique under compare, with values
+// (if given) holding each key's value. Consumes both vectors.
+template <typename Key, typename Value = NoValue, typename Compare = less<Key>>
+FrozenTree<Key, Value, Compare> *frozen_build(vector<Key> keys, vector<Value> values = {},
+                                              Compare compare = Compare()) {
+  FrozenTree<Key, Value, Compare> *frozen = new FrozenTree<Key, Value, Compare>();
+  frozen->size = keys.size();
+  frozen->compare = compare;
+  frozen->keys.resize(frozen->size + 1);
+  if (!is_empty<Value>::value) frozen->values.resize(frozen->size + 1);
+  size_t next = 0;
+  frozen_fill(frozen, keys, values, next, 1);
+  return frozen;
+}
+
+template <typename Key, typename Value, typename Compare>
+void frozen_free(FrozenTree<Key, Value, Compare> *&frozen) {
+  delete frozen;
+  frozen = nullptr;
+}
+
+// Index of the first key not less than key, 0 if there is none. The loop body
+// has no branch on the comparison, so it never mispredicts: going right adds
+// one to the index, and where the search last went left is recovered at the end
+// by stripping the trailing right turns (and that left turn) off the index.
+template <typename Key, typename Value, typename Compare>
+inline size_t frozen_search(FrozenTree<Key, Value, Compare> *&frozen, Arg<Key> key) {
+  const Key *keys = frozen->keys.data();
+  size_t n = frozen->size;
+  size_t k = 1;
+  while (k <= n) {
+    __builtin_prefetch(keys + min(k * frozen_prefetch_stride<Key>(), n));
+    k = 2 * k + frozen->compare(keys[k], key);
+  }
+  return k >> __builtin_ffsll(~k);
+}
+
+// Returns whether key is in the frozen tree
+template <typename Key, typename Value, typename Compare>
+bool frozen_lookup(FrozenTree<Key, Value, Compare> *&frozen, Arg<Key> key) {
+  size_t k = frozen_search(frozen, key);
+  return k && !frozen->compare(key, frozen->keys[k]);
+}
+
+// Copies the value stored with key into value, returns false if key isn't there
+template <typename Key, typename Value, typename Compare>
+bool frozen_find(FrozenTree<Key, Value, Compare> *&frozen, Arg<Key> key, Value &value) {
+  size_t k = frozen_search(frozen, key);
+  if (!k || frozen->compare(key, frozen->keys[k])) return false;
+  if constexpr (!is_empty<Value>::value) value = frozen->values[k];
+  return true;
+}
+
+/******************************************************************************/
+/*                             BATCHED LOOKUPS                                */
+/******************************************************************************/
+/*   A batch is searched FROZEN_BATCH keys at a time, all of them walked down */
+/*   the tree in lockstep so their cache misses on each level overlap. Every  */
+/*   search takes the same number of steps (the tree's height): a search that */
+/*   has already run off the bottom keeps going right, which the final        */
+/*   stripping of trailing right turns undoes. For int keys in their natural  */
+/*   order each step is done for 8 (AVX2) or 16 (AVX-512) keys at once with a */
+/*   gather, picked at run time from what the CPU supports.                   */
+/******************************************************************************/
+
+#define FROZEN_BATCH 32
+
+#if defined(__x86_64__)
+// One step down for every key in a group of FROZEN_BATCH, 8 keys per vector
+__attribute__((target("avx2")))
+inline void frozen_search_avx2(const int *keys, uint32_t n, int levels, const int *queries, uint32_t *indices) {
+  const int vectors = FROZEN_BATCH / 8;
+  const __m256i size = _mm256_set1_epi32(n);
+  __m256i query[vectors], k[vectors];
+  for (int v = 0; v < vectors; v++) {
+    query[v] = _mm256_loadu_si256((const __m256i *)(queries + 8 * v));
+    k[v] = _mm256_set1_epi32(1);
+  }
+  for (int level = 0; level < levels; level++) {
+    for (int v = 0; v < vectors; v++) {
+      // Searches past the bottom read the last key and go right regardless
+      __m256i key = _mm256_i32gather_epi32(keys, _mm256_min_epu32(k[v], size), 4);
+      __m256i right = _mm256_or_si256(_mm256_cmpgt_epi32(query[v], key), _mm256_cmpgt_epi32(k[v], size));
+      // right is -1 where the search goes right
+      k[v] = _mm256_sub_epi32(_mm256_add_epi32(k[v], k[v]), right);
+    }
+  }
+  for (int v = 0; v < vectors; v++) {
+    _mm256_storeu_si256((__m256i *)(indices + 8 * v), k[v]);
+  }
+}
+
+// Same as frozen_search_avx2, 16 keys per vector
+__attribute__((target("avx512f")))
+inline void frozen_search_avx512(const int *keys, uint32_t n, int levels, const int *queries, uint32_t *indices) {
+  const int vectors = FROZEN_BATCH / 16;
+  const __m512i size = _mm512_set1_epi32(n);
+  const __m512i one = _mm512_set1_epi32(1);
+  __m512i query[vectors], k[vectors];
+  for (int v = 0; v < vectors; v++) {
+    query[v] = _mm512_loadu_si512(queries + 16 * v);
+    k[v] = one;
+  }
+  for (int level = 0; level < levels; level++) {
+    for (int v = 0; v < vectors; v++) {
+      // (The masked forms, as the unmasked ones start from an undefined vector
+      // that GCC warns about)
+      __mmask16 past = _mm512_cmpgt_epu32_mask(k[v], size);
+      __m512i at = _mm512_mask_mov_epi32(k[v], past, size);
+      __m512i key = _mm512_mask_i32gather_epi32(at, (__mmask16)0xFFFF, at, keys, 4);
+      __mmask16 right = _mm512_cmpgt_epi32_mask(query[v], key) | past;
+      __m512i twice = _mm512_add_epi32(k[v], k[v]);
+      k[v] = _mm512_mask_add_epi32(twice, right, twice, one);
+    }
+  }
+  for (int v = 0; v < vectors; v++) {
+    _mm512_storeu_si512(indices + 16 * v, k[v]);
+  }
+}
+#endif
+
+// Walks count (at most FROZEN_BATCH) searches down the tree in lockstep, leaving
+// each one's final Eytzinger index (before stripping right turns) in indices
+template <typename Key, typename Value, typename Compare>
+void frozen_search_group(FrozenTree<Key, Value, Compare> *&frozen, const Key *queries, size_t count,
+                         size_t *indices) {
+  const Key *keys = frozen->keys.data();
+  size_t n = frozen->size;
+  int levels = n ? 64 - __builtin_clzll(n) : 0;
+#if defined(__x86_64__)
+  // Indices up to 2n + 1 have to fit the vector lanes
+  if constexpr (is_same<Key, int>::value && is_same<Compare, less<int>>::value) {
+    static const bool avx512 = __builtin_cpu_supports("avx512f");
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if ((avx512 || avx2) && n < ((size_t)1 << 30)) {
+      int padded[FROZEN_BATCH] = {0};
+      uint32_t lanes[FROZEN_BATCH];
+      copy(queries, queries + count, padded);
+      if (avx512) {
+        frozen_search_avx512(keys, n, levels, padded, lanes);
+      } else {
+        frozen_search_avx2(keys, n, levels, padded, lanes);
+      }
+      copy(lanes, lanes + count, indices);
+      return;
+    }
+  }
+#endif
+  fill(indices, indices + count, 1);
+  for (int level = 0; level < levels; level++) {
+    for (size_t i = 0; i < count; i++) {
+      size_t k = indices[i];
+      indices[i] = 2 * k + (k > n || frozen->compare(keys[k], queries[i]));
+      __builtin_prefetch(keys + min(indices[i] * frozen_prefetch_stride<Key>(), n));
+    }
+  }
+}
+
+// Looks up every key in keys, setting results[i] to whether keys[i] is in the
+// frozen tree, returns how many were
+template <typename Key, typename Value, typename Compare>
+size_t frozen_lookup_batch(FrozenTree<Key, Value, Compare> *&frozen, const vector<Key> &keys,
+                           vector<bool> &results) {
+  size_t indices[FROZEN_BATCH];
+  size_t found = 0;
+  results.assign(keys.size(), false);
+  for (size_t start = 0; start < keys.size(); start += FROZEN_BATCH) {
+    size_t count = min((size_t)FROZEN_BATCH, keys.size() - start);
+    frozen_search_group(frozen, keys.data() + start, count, indices);
+    for (size_t i = 0; i < count; i++) {
+      size_t k = indices[i] >> __builtin_ffsll(~indices[i]);
+      if (k && !frozen->compare(keys[start + i], frozen->keys[k])) {
+        results[start + i] = true;
+        found++;
+      }
+    }
+  }
+  return found;
+}
+
+// Bytes held by the frozen tree (not counting memory owned by keys and values)
+template <typename Key, typename Value, typename Compare>
+size_t frozen_bytes(FrozenTree<Key, Value, Compare> *&frozen) {
+  return sizeof(FrozenTree<Key, Value, Compare>) + frozen->keys.capacity() * sizeof(Key) +
+         frozen->values.capacity() * sizeof(Value);
+}
+
+#endif
@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <numeric>
+#include <parallel/algorithm>
+
+using namespace std;
+
+/******************************************************************************/
+/*                          JOIN-BASED BATCH OPERATIONS                       */
+/******************************************************************************/
+/*   tree_insert_batch and tree_delete_batch merge a whole sorted batch into   */
+/*   the tree by divide and conquer on split and join (Blelloch, Ferizovic and */
+/*   Sun, "Just Join for Parallel Ordered Sets"): the tree is split around the */
+/*   middle key of the batch, each half of the batch is merged into its side  */
+/*   of the tree in parallel, and the two results are joined back together.   */
+/*   This is O(m log(n/m + 1)) work for m keys and takes no flags at all, so   */
+/*   no other thread may use the tree while a batch is being merged.           */
+/******************************************************************************/
+
+// Batches with fewer keys than this are merged by the task that got them
+#define BATCH_TASK_SIZE 1024
+
+// A subtree along with its black height (the number of black nodes on every
+// path from its root down to a null child, 0 for an empty subtree)
+template <typename Key, typename Value>
+struct Subtree {
+  RedBlackNode<Key, Value> *root;
+  int black_height;
+};
+
+// What split returns: the keys below and above the split key, and its node if any
+template <typename Key, typename Value>
+struct SplitTree {
+  Subtree<Key, Value> left;
+  RedBlackNode<Key, Value> *found;
+  Subtree<Key, Value> right;
+};
+
+// Makes node the parent of left and right, with the given color (and the size of
+// the subtree they now make up)
+template <typename Key, typename Value>
+inline void link_children(RedBlackNode<Key, Value> *node, RedBlackNode<Key, Value> *left,
+                          RedBlackNode<Key, Value> *right, bool red) {
+  node->child[0].store(left, memory_order_relaxed);
+  node->child[1].store(right, memory_order_relaxed);
+  if (left) left->parent = node;
+  if (right) right->parent = node;
+  node->red = red;
+  node->size.store(node_size(left) + node_size(right) + 1, memory_order_relaxed);
+}
+
+// Rotates the subtree at root in direction dir and returns its new root (like
+// rotateDir, but for subtrees not yet linked into the tree)
+template <typename Key, typename Value>
+RedBlackNode<Key, Value> *rotate_subtree(RedBlackNode<Key, Value> *root, int dir) {
+  RedBlackNode<Key, Value> *rotatingChild = root->child[1-dir];
+  RedBlackNode<Key, Value> *C = rotatingChild->child[dir];
+  root->child[1-dir].store(C, memory_order_relaxed);
+  if (C) C->parent = root;
+  rotatingChild->child[dir].store(root, memory_order_relaxed);
+  rotatingChild->parent = root->parent;
+  root->parent = rotatingChild;
+  rotatingChild->size.store(node_size(root), memory_order_relaxed);
+  root->size.store(node_size(root->child[0].load(memory_order_relaxed)) +
+                   node_size(root->child[1].load(memory_order_relaxed)) + 1, memory_order_relaxed);
+  return rotatingChild;
+}
+
+// Joins node and the shorter black-rooted subtree low onto the taller subtree
+// tall, on its right if dir is 1 (left if 0): node goes in red at the first
+// black node down that spine whose black height matches low's, and red-red
+// violations are fixed by rotations on the way back up. The result has tall's
+// black height but may have a red root.
+template <typename Key, typename Value>
+RedBlackNode<Key, Value> *join_tall(RedBlackNode<Key, Value> *tall, int tall_height,
+                                    RedBlackNode<Key, Value> *node, RedBlackNode<Key, Value> *low,
+                                    int low_height, int dir) {
+  if (!is_red(tall) && tall_height == low_height) {
+    if (dir) {
+      link_children(node, tall, low, true);
+    } else {
+      link_children(node, low, tall, true);
+    }
+    return node;
+  }
+
+  RedBlackNode<Key, Value> *joined = join_tall(tall->child[dir].load(memory_order_relaxed),
+                                               tall_height - !tall->red, node, low, low_height, dir);
+  tall->child[dir].store(joined, memory_order_relaxed);
+  joined->parent = tall;
+  tall->size.store(node_size(tall->child[0].load(memory_order_relaxed)) +
+                   node_size(tall->child[1].load(memory_order_relaxed)) + 1, memory_order_relaxed);
+  if (!tall->red && is_red(joined) && is_red(joined->child[dir].load(memory_order_relaxed))) {
+    joined->child[dir].load(memory_order_relaxed)->red = false;
+    return rotate_subtree(tall, 1-dir);
+  }
+  return tall;
+}
+
+// Returns the subtree holding left's keys, then node, then right's keys
+template <typename Key, typename Value>
+Subtree<Key, Value> join(Subtree<Key, Value> left, RedBlackNode<Key, Value> *node, Subtree<Key, Value> right) {
+  // Any subtree stays valid with a black root, which makes the cases below simpler
+  for (Subtree<Key, Value> *side : {&left, &right}) {
+    if (is_red(side->root)) {
+      side->root->red = false;
+      side->black_height++;
+    }
+  }
+
+  if (left.black_height > right.black_height) {
+    return {join_tall(left.root, left.black_height, node, right.root, right.black_height, 1), left.black_height};
+  }
+  if (right.black_height > left.black_height) {
+    return {join_tall(right.root, right.black_height, node, left.root, left.black_height, 0), right.black_height};
+  }
+  link_children(node, left.root, right.root, true);
+  return {node, left.black_height};
+}
+
+// Splits the subtree at node (of the given black height) into the keys below key,
+// the node holding key (if any) and the keys above it
+template <typename Key, typename Value, typename Compare>
+SplitTree<Key, Value> split(RedBlackTree<Key, Value, Compare> *&tree, RedBlackNode<Key, Value> *node,
+                            int black_height, Arg<Key> key) {
+  if (!node) {
+    return {{nullptr, 0}, nullptr, {nullptr, 0}};
+  }
+  int child_height = black_height - !node->red;
+  Subtree<Key, Value> left = {node->child[0].load(memory_order_relaxed), child_height};
+  Subtree<Key, Value> right = {node->child[1].load(memory_order_relaxed), child_height};
+
+  bool equal;
+  int dir = key_direction(tree, key, node->key, equal);
+  if (equal) {
+    return {left, node, right};
+  }
+  if (dir) {
+    SplitTree<Key, Value> split_right = split(tree, right.root, right.black_height, key);
+    split_right.left = join(left, node, split_right.left);
+    return split_right;
+  }
+  SplitTree<Key, Value> split_left = split(tree, left.root, left.black_height, key);
+  split_left.right = join(split_left.right, node, right);
+  return split_left;
+}
+
+// Removes the node with the largest key from a non-empty subtree, returning it
+// and leaving the rest in subtree
+template <typename Key, typename Value>
+RedBlackNode<Key, Value> *split_last(Subtree<Key, Value> &subtree) {
+  RedBlackNode<Key, Value> *node = subtree.root;
+  int child_height = subtree.black_height - !node->red;
+  Subtree<Key, Value> left = {node->child[0].load(memory_order_relaxed), child_height};
+  Subtree<Key, Value> right = {node->child[1].load(memory_order_relaxed), child_height};
+  if (!right.root) {
+    subtree = left;
+    return node;
+  }
+  RedBlackNode<Key, Value> *last = split_last(right);
+  subtree = join(left, node, right);
+  return last;
+}
+
+// Returns the subtree holding left's keys and then right's keys
+template <typename Key, typename Value>
+Subtree<Key, Value> join_pair(Subtree<Key, Value> left, Subtree<Key, Value> right) {
+  if (!left.root) return right;
+  RedBlackNode<Key, Value> *last = split_last(left);
+  return join(left, last, right);
+}
+
+// Merges keys[lo, hi) (sorted and unique) into subtree, adding how many of them
+// weren't in it yet to inserted
+template <typename Key, typename Value, typename Compare>
+Subtree<Key, Value> insert_sorted(RedBlackTree<Key, Value, Compare> *&tree, Subtree<Key, Value> subtree,
+                                  const vector<Key> &keys, const vector<Value> &values, size_t lo, size_t hi,
+                                  size_t &inserted) {
+  if (lo >= hi) return subtree;
+  if (!subtree.root) {
+    // Nothing left to merge with, the rest of the batch becomes a subtree as is
+    int red_depth = sorted_red_depth(hi - lo);
+    inserted += hi - lo;
+    return {build_subtree(tree, keys, values, lo, hi, 0, red_depth, (RedBlackNode<Key, Value> *)nullptr),
+            max(red_depth, 1)};
+  }
+
+  size_t mid = lo + (hi - lo) / 2;
+  SplitTree<Key, Value> parts = split(tree, subtree.root, subtree.black_height, keys[mid]);
+  Subtree<Key, Value> left, right;
+  size_t left_inserted = 0, right_inserted = 0;
+  if (hi - lo >= BATCH_TASK_SIZE) {
+    #pragma omp task shared(tree, keys, values, parts, left, left_inserted)
+    left = insert_sorted(tree, parts.left, keys, values, lo, mid, left_inserted);
+    right = insert_sorted(tree, parts.right, keys, values, mid + 1, hi, right_inserted);
+    #pragma omp taskwait
+  } else {
+    left = insert_sorted(tree, parts.left, keys, values, lo, mid, left_inserted);
+    right = insert_sorted(tree, parts.right, keys, values, mid + 1, hi, right_inserted);
+  }
+  inserted += left_inserted + right_inserted;
+
+  // A key already in the tree keeps its node (and value)
+  RedBlackNode<Key, Value> *node = parts.found;
+  if (!node) {
+    node = newTreeNode(tree, keys[mid], values.empty() ? Value() : values[mid], true, nullptr, nullptr, nullptr);
+    inserted++;
+  }
+  return join(left, node, right);
+}
+
+// Removes keys[lo, hi) (sorted and unique) from subtree, adding how many of them
+// were in it to deleted
+template <typename Key, typename Value, typename Compare>
+Subtree<Key, Value> delete_sorted(RedBlackTree<Key, Value, Compare> *&tree, Subtree<Key, Value> subtree,
+                                  const vector<Key> &keys, size_t lo, size_t hi, size_t &deleted) {
+  if (lo >= hi || !subtree.root) return subtree;
+
+  size_t mid = lo + (hi - lo) / 2;
+  SplitTree<Key, Value> parts = split(tree, subtree.root, subtree.black_height, keys[mid]);
+  Subtree<Key, Value> left, right;
+  size_t left_deleted = 0, right_deleted = 0;
+  if (hi - lo >= BATCH_TASK_SIZE) {
+    #pragma omp task shared(tree, keys, parts, left, left_deleted)
+    left = delete_sorted(tree, parts.left, keys, lo, mid, left_deleted);
+    right = delete_sorted(tree, parts.right, keys, mid + 1, hi, right_deleted);
+    #pragma omp taskwait
+  } else {
+    left = delete_sorted(tree, parts.left, keys, lo, mid, left_deleted);
+    right = delete_sorted(tree, parts.right, keys, mid + 1, hi, right_deleted);
+  }
+  deleted += left_deleted + right_deleted;
+
+  if (parts.found) {
+    parts.found->removed = true;
+    epoch_retire(parts.found, free_tree_node<Key, Value>, tree->pool);
+    deleted++;
+  }
+  return join_pair(left, right);
+}
+
+// Sorts keys (and values, if given, along with them) with the tree's Compare and
+// drops repeated keys, keeping the first one in the batch
+template <typename Key, typename Value, typename Compare>
+void sort_batch(RedBlackTree<Key, Value, Compare> *&tree, vector<Key> &keys, vector<Value> &values,
+                int num_threads) {
+  vector<size_t> order(keys.size());
+  iota(order.begin(), order.end(), 0);
+  auto before = [&](size_t a, size_t b) {
+    if (tree->compare(keys[a], keys[b])) return true;
+    return !tree->compare(keys[b], keys[a]) && a < b;
+  };
+  if (num_threads > 1) {
+    __gnu_parallel::sort(order.begin(), order.end(), before, __gnu_parallel::multiway_mergesort_tag(num_threads));
+  } else {
+    sort(order.begin(), order.end(), before);
+  }
+
+  vector<Key> sorted_keys;
+  vector<Value> sorted_values;
+  sorted_keys.reserve(keys.size());
+  for (size_t i : order) {
+    if (!sorted_keys.empty() && !tree->compare(sorted_keys.back(), keys[i])) continue;
+    sorted_keys.push_back(keys[i]);
+    if (!values.empty()) sorted_values.push_back(values[i]);
+  }
+  keys.swap(sorted_keys);
+  values.swap(sorted_values);
+}
+
+// Black height of the whole tree, read down its leftmost path
+template <typename Key, typename Value, typename Compare>
+int tree_black_height(RedBlackTree<Key, Value, Compare> *&tree) {
+  int black_height = 0;
+  for (RedBlackNode<Key, Value> *node = tree->head.child[0].load(); node;
+       node = node->child[0].load(memory_order_relaxed)) {
+    black_height += !node->red;
+  }
+  return black_height;
+}
+
+// Makes subtree the whole tree, publishing it to other threads
+template <typename Key, typename Value, typename Compare>
+void set_tree_root(RedBlackTree<Key, Value, Compare> *&tree, Subtree<Key, Value> subtree) {
+  RedBlackNode<Key, Value> *head = &tree->head;
+  if (subtree.root) {
+    subtree.root->parent = head;
+    // Root always stays black
+    subtree.root->red = false;
+  }
+  begin_modify(head);
+  head->child[0].store(subtree.root, memory_order_release);
+  end_modify(head);
+}
+
+// Inserts a batch of keys (in any order, with values if given) using num_threads
+// threads, returns how many of them weren't in the tree yet. Keys already in the
+// tree keep their value.
+template <typename Key, typename Value, typename Compare>
+size_t tree_insert_batch(RedBlackTree<Key, Value, Compare> *&tree, vector<Key> keys, vector<Value> values,
+                         int num_threads) {
+  if (!values.empty() && values.size() != keys.size()) return 0;
+  sort_batch(tree, keys, values, num_threads);
+
+  size_t inserted = 0;
+  Subtree<Key, Value> merged;
+  #pragma omp parallel num_threads(num_threads)
+  #pragma omp single
+  merged = insert_sorted(tree, {tree->head.child[0].load(), tree_black_height(tree)}, keys, values, 0, keys.size(),
+                         inserted);
+  set_tree_root(tree, merged);
+  return inserted;
+}
+
+// Deletes a batch of keys (in any order) using num_threads threads, returns how
+// many of them were in the tree
+template <typename Key, typename Value, typename Compare>
+size_t tree_delete_batch(RedBlackTree<Key, Value, Compare> *&tree, vector<Key> keys, int num_threads) {
+  vector<Value> values;
+  sort_batch(tree, keys, values, num_threads);
+
+  size_t deleted = 0;
+  Subtree<Key, Value> remaining;
+  #pragma omp parallel num_threads(num_threads)
+  #pragma omp single
+  remaining = delete_sorted(tree, {tree->head.child[0].load(), tree_black_height(tree)}, keys, 0, keys.size(), deleted);
+  set_tree_root(tree, remaining);
+  return deleted;
+}
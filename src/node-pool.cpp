@@ -0,0 +1,155 @@
+#include "node-pool.h"
+#include <stdlib.h>
+#include <vector>
+#include <mutex>
+#include <unordered_set>
+
+using namespace std;
+
+static atomic<uint64_t> next_pool_id(1);
+
+// Ids of the pools not freed yet, so threads can drop their entries for the rest
+static mutex live_pools_lock;
+static unordered_set<uint64_t> live_pools;
+
+// Arenas this thread owns in each pool it has used, with the last one cached
+// since a thread almost always works on one tree at a time
+static thread_local vector<pair<uint64_t, PoolArena_t>> thread_arenas;
+static thread_local pair<uint64_t, PoolArena_t> last_arena = {0, nullptr};
+
+// Initializes an empty pool for nodes of node_size bytes
+NodePool_t pool_init(size_t node_size) {
+  NodePool_t pool = new struct NodePool();
+  // Small nodes get a power of two slot (so they pack evenly into cache lines),
+  // larger ones a whole number of cache lines
+  size_t slot_size = sizeof(void *);
+  while (slot_size < node_size && slot_size < CACHE_LINE_SIZE) {
+    slot_size *= 2;
+  }
+  if (slot_size < node_size) {
+    slot_size = (node_size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+  }
+  pool->slot_size = slot_size;
+  pool->id = next_pool_id++;
+  pool->arenas = nullptr;
+  pool->slabs = 0;
+  pool->refs = 1;
+  lock_guard<mutex> guard(live_pools_lock);
+  live_pools.insert(pool->id);
+  return pool;
+}
+
+// Returns the calling thread's arena in pool, creating it on first use
+static PoolArena_t thread_arena(NodePool_t pool) {
+  if (last_arena.first == pool->id) return last_arena.second;
+
+  PoolArena_t arena = nullptr;
+  for (auto &entry : thread_arenas) {
+    if (entry.first == pool->id) {
+      arena = entry.second;
+      break;
+    }
+  }
+  if (!arena) {
+    // Entries for pools freed since can't be used again, drop them before
+    // adding this one so the list only ever holds live pools
+    {
+      lock_guard<mutex> guard(live_pools_lock);
+      erase_if(thread_arenas, [](auto &entry) { return !live_pools.count(entry.first); });
+    }
+    arena = new struct PoolArena();
+    arena->free_list = nullptr;
+    arena->next_slot = nullptr;
+    arena->slab_end = nullptr;
+    arena->slabs = nullptr;
+    arena->next = pool->arenas.load();
+    while (!pool->arenas.compare_exchange_weak(arena->next, arena));
+    thread_arenas.push_back({pool->id, arena});
+  }
+  last_arena = {pool->id, arena};
+  return arena;
+}
+
+// Returns an uninitialized slot for one node
+void *pool_alloc(NodePool_t pool) {
+  PoolArena_t arena = thread_arena(pool);
+
+  // Reuse a freed node if there is one
+  if (arena->free_list) {
+    void *slot = arena->free_list;
+    arena->free_list = *(void **)slot;
+    return slot;
+  }
+
+  // Otherwise carve one out of the current slab, starting a new slab when full
+  if (arena->next_slot + pool->slot_size > arena->slab_end) {
+    char *slab = (char *)aligned_alloc(CACHE_LINE_SIZE, POOL_SLAB_SIZE);
+    *(void **)slab = arena->slabs;
+    arena->slabs = slab;
+    // The first slot holds the slab chain
+    arena->next_slot = slab + pool->slot_size;
+    arena->slab_end = slab + POOL_SLAB_SIZE;
+    pool->slabs.fetch_add(1, memory_order_relaxed);
+  }
+  void *slot = arena->next_slot;
+  arena->next_slot += pool->slot_size;
+  return slot;
+}
+
+// Returns a node's slot to the calling thread's free list
+void pool_free(NodePool_t pool, void *slot) {
+  PoolArena_t arena = thread_arena(pool);
+  *(void **)slot = arena->free_list;
+  arena->free_list = slot;
+}
+
+// Frees every slab of every arena in the pool, along with the pool itself
+static void pool_free_slabs(NodePool_t pool) {
+  {
+    lock_guard<mutex> guard(live_pools_lock);
+    live_pools.erase(pool->id);
+  }
+  PoolArena_t arena = pool->arenas.load();
+  while (arena) {
+    void *slab = arena->slabs;
+    while (slab) {
+      void *next_slab = *(void **)slab;
+      free(slab);
+      slab = next_slab;
+    }
+    PoolArena_t next_arena = arena->next;
+    delete arena;
+    arena = next_arena;
+  }
+  delete pool;
+}
+
+// Releases the owner's reference to the pool, freeing all of its memory as soon
+// as no retained node is left (right away unless nodes are awaiting reclamation)
+// The owner may not use the pool (or any node allocated from it) afterwards
+void pool_destroy(NodePool_t pool) {
+  pool_release(pool);
+}
+
+// Keeps the pool alive for a node that is still going to be pool_free'd after
+// its owner may have called pool_destroy, e.g. one awaiting epoch reclamation
+void pool_retain(NodePool_t pool) {
+  pool->refs.fetch_add(1, memory_order_relaxed);
+}
+
+// Drops a reference taken by pool_retain (once the node has been pool_free'd)
+void pool_release(NodePool_t pool) {
+  if (pool->refs.fetch_sub(1, memory_order_acq_rel) == 1) {
+    pool_free_slabs(pool);
+  }
+}
+
+// Bytes of memory the pool holds, whether slots are in use or not
+size_t pool_bytes(NodePool_t pool) {
+  size_t arenas = 0;
+  for (PoolArena_t arena = pool->arenas.load(); arena; arena = arena->next) {
+    arenas++;
+  }
+  return sizeof(struct NodePool) + arenas * sizeof(struct PoolArena)
+         + pool->slabs.load(memory_order_relaxed) * POOL_SLAB_SIZE;
+}
@@ -0,0 +1,48 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+using namespace std;
+
+#define CACHE_LINE_SIZE 64
+// Size of each slab a thread carves nodes out of
+#define POOL_SLAB_SIZE (64 * 1024)
+
+// A thread's private part of a pool: nodes are bump-allocated from its current
+// slab, and nodes it frees go on its own free list for reuse
+typedef struct alignas(CACHE_LINE_SIZE) PoolArena {
+  void *free_list;
+  char *next_slot;
+  char *slab_end;
+  // Slabs owned by this arena, chained through their first slot
+  void *slabs;
+  struct PoolArena *next;
+} *PoolArena_t;
+
+// Fixed-size node allocator with one arena per thread, so allocating and freeing
+// never synchronize. All memory is released at once by pool_destroy.
+typedef struct NodePool {
+  // Node size rounded up so a node never straddles two cache lines
+  size_t slot_size;
+  // Unique for the lifetime of the process, used to find a thread's arena
+  uint64_t id;
+  atomic<PoolArena_t> arenas;
+  // Slabs allocated across all arenas
+  atomic<size_t> slabs;
+  // The owner's reference plus one per retained node (see pool_retain)
+  atomic<size_t> refs;
+} *NodePool_t;
+
+// Pool Functions
+NodePool_t pool_init(size_t node_size);
+void *pool_alloc(NodePool_t pool);
+void pool_free(NodePool_t pool, void *slot);
+void pool_destroy(NodePool_t pool);
+void pool_retain(NodePool_t pool);
+void pool_release(NodePool_t pool);
+size_t pool_bytes(NodePool_t pool);
+
+#endif
@@ -0,0 +1,296 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <cmath>
+#include <string.h>
+#include <unistd.h>
+#include <omp.h>
+#include "engine.h"
+
+using namespace std;
+
+/******************************************************************************/
+/*                        MIXED WORKLOAD BENCHMARK                            */
+/******************************************************************************/
+/*   YCSB-style timed runs: a tree over keys 0..num_keys-1 is filled with a   */
+/*   random half of them, then every thread draws operations from a          */
+/*   lookup/insert/delete mix and keys from a uniform or Zipfian             */
+/*   distribution for a fixed time. Reports throughput, how evenly the       */
+/*   threads got their operations through, and latency percentiles from     */
+/*   every LATENCY_SAMPLE-th operation.                                      */
+/******************************************************************************/
+
+// Operations between checks of the clock
+#define OPS_PER_CHECK 32
+// Every this many operations one is timed on its own
+#define LATENCY_SAMPLE 8
+
+static const Engine_t *engines[] = {&sequential_engine, &rwlock_engine, &hand_over_hand_engine, &lock_free_engine,
+                                    &sharded_sequential_engine, &sharded_lock_free_engine, &combining_engine};
+
+// Percentages of lookups, inserts and deletes
+typedef struct Mix {
+  int lookup;
+  int insert;
+  int remove;
+} Mix_t;
+
+// YCSB's Zipfian generator (Gray et al., "Quickly Generating Billion-Record
+// Synthetic Databases"): rank 0 is the most popular. Ranks are scrambled
+// through a hash before use so the popular keys are spread over the key space
+// instead of bunched at its start.
+typedef struct Zipfian {
+  uint64_t n;
+  double theta;
+  double alpha;
+  double zetan;
+  double eta;
+} Zipfian_t;
+
+static Zipfian_t zipfian_init(uint64_t n, double theta) {
+  Zipfian_t zipfian;
+  zipfian.n = n;
+  zipfian.theta = theta;
+  zipfian.alpha = 1 / (1 - theta);
+  zipfian.zetan = 0;
+  for (uint64_t i = 1; i <= n; i++) {
+    zipfian.zetan += 1 / pow((double)i, theta);
+  }
+  double zeta2 = 1 + 1 / pow(2.0, theta);
+  zipfian.eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zipfian.zetan);
+  return zipfian;
+}
+
+// Rank drawn for a uniform u in [0, 1)
+static uint64_t zipfian_rank(const Zipfian_t &zipfian, double u) {
+  double uz = u * zipfian.zetan;
+  if (uz < 1) return 0;
+  if (uz < 1 + pow(0.5, zipfian.theta)) return 1;
+  uint64_t rank = zipfian.n * pow(zipfian.eta * u - zipfian.eta + 1, zipfian.alpha);
+  return min(rank, zipfian.n - 1);
+}
+
+// FNV-1a over the rank's bytes
+static uint64_t scramble(uint64_t rank) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (int i = 0; i < 8; i++) {
+    hash = (hash ^ ((rank >> (8 * i)) & 0xff)) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+// What one run measured
+typedef struct RunResult {
+  double mops;
+  // Fewest operations any thread got through over the most any thread did
+  double fairness;
+  double p50;
+  double p99;
+  double p999;
+} RunResult_t;
+
+// Latency (ns) below which fraction of the samples fall, samples must be sorted
+static double percentile(const vector<uint32_t> &samples, double fraction) {
+  if (samples.empty()) return 0;
+  return samples[min(samples.size() - 1, (size_t)(fraction * samples.size()))];
+}
+
+// Fills a fresh tree with a random half of the keys, then runs mix on it with
+// num_threads threads for duration seconds. zipfian is null for uniform keys.
+static RunResult_t run_mix(const Engine_t *engine, Mix_t mix, const Zipfian_t *zipfian, int num_keys,
+                           int num_threads, double duration) {
+  void *tree = engine->create(num_threads, num_keys);
+  mt19937_64 fill_rng(1);
+  vector<int> keys;
+  for (int key = 0; key < num_keys; key++) {
+    if (fill_rng() & 1) keys.push_back(key);
+  }
+  shuffle(keys.begin(), keys.end(), fill_rng);
+  for (int key : keys) {
+    engine->insert(tree, key);
+  }
+
+  vector<uint64_t> thread_ops(num_threads, 0);
+  vector<vector<uint32_t>> thread_samples(num_threads);
+  chrono::steady_clock::time_point start, deadline;
+  double elapsed = 0;
+
+  #pragma omp parallel num_threads(num_threads)
+  {
+    int id = omp_get_thread_num();
+    mt19937_64 rng(id + 1);
+    uniform_int_distribution<int> percent(0, 99), uniform_key(0, num_keys - 1);
+    uniform_real_distribution<double> unit(0, 1);
+    vector<uint32_t> &samples = thread_samples[id];
+    samples.reserve(1 << 20);
+    uint64_t ops = 0;
+
+    #pragma omp single
+    {
+      start = chrono::steady_clock::now();
+      deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(duration));
+    }
+
+    while (chrono::steady_clock::now() < deadline) {
+      for (int i = 0; i < OPS_PER_CHECK; i++, ops++) {
+        int key = zipfian ? scramble(zipfian_rank(*zipfian, unit(rng))) % num_keys : uniform_key(rng);
+        int choice = percent(rng);
+        bool timed = ops % LATENCY_SAMPLE == 0;
+        chrono::steady_clock::time_point op_start;
+        if (timed) op_start = chrono::steady_clock::now();
+        if (choice < mix.lookup) {
+          engine->lookup(tree, key);
+        } else if (choice < mix.lookup + mix.insert) {
+          engine->insert(tree, key);
+        } else {
+          engine->remove(tree, key);
+        }
+        if (timed) {
+          samples.push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - op_start)
+                                .count());
+        }
+      }
+    }
+    thread_ops[id] = ops;
+
+    #pragma omp barrier
+    #pragma omp single
+    elapsed = chrono::duration_cast<chrono::duration<double>>(chrono::steady_clock::now() - start).count();
+  }
+  engine->destroy(tree, num_threads);
+
+  vector<uint32_t> samples;
+  for (auto &thread : thread_samples) {
+    samples.insert(samples.end(), thread.begin(), thread.end());
+  }
+  sort(samples.begin(), samples.end());
+  uint64_t total = accumulate(thread_ops.begin(), thread_ops.end(), (uint64_t)0);
+  auto [fewest, most] = minmax_element(thread_ops.begin(), thread_ops.end());
+
+  RunResult_t result;
+  result.mops = total / elapsed / 1e6;
+  result.fairness = *most ? (double)*fewest / *most : 0;
+  result.p50 = percentile(samples, 0.5);
+  result.p99 = percentile(samples, 0.99);
+  result.p999 = percentile(samples, 0.999);
+  return result;
+}
+
+// Splits a comma separated list
+static vector<string> split_list(const string &list) {
+  vector<string> items;
+  stringstream ss(list);
+  string item;
+  while (getline(ss, item, ',')) {
+    if (!item.empty()) items.push_back(item);
+  }
+  return items;
+}
+
+int main(int argc, char *argv[]) {
+  string engine_list, mix_list = "100/0/0,90/5/5,50/25/25", distribution_list = "uniform,zipfian";
+  int num_keys = 1000000;
+  int max_threads = 8;
+  double duration = 1;
+  double theta = 0.99;
+  int opt;
+  while ((opt = getopt(argc, argv, "e:w:d:z:k:n:t:")) != -1) {
+    switch (opt) {
+      case 'e':
+        engine_list = optarg;
+        break;
+      case 'w':
+        mix_list = optarg;
+        break;
+      case 'd':
+        distribution_list = optarg;
+        break;
+      case 'z':
+        theta = atof(optarg);
+        break;
+      case 'k':
+        num_keys = atoi(optarg);
+        break;
+      case 'n':
+        max_threads = atoi(optarg);
+        break;
+      case 't':
+        duration = atof(optarg);
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [-e engine,...] [-w lookup/insert/delete,...] [-d uniform,zipfian]\n", argv[0]);
+        fprintf(stderr, "          [-z zipfian_theta] [-k num_keys] [-n max_threads] [-t seconds_per_run]\n");
+        exit(EXIT_FAILURE);
+    }
+  }
+  if (num_keys < 2 || max_threads < 1 || duration <= 0 || theta <= 0 || theta >= 1) {
+    fprintf(stderr, "Need at least 2 keys, 1 thread, a positive duration and 0 < theta < 1\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // Engines by name, all of them by default
+  vector<const Engine_t *> chosen;
+  for (const string &name : split_list(engine_list)) {
+    auto engine = find_if(begin(engines), end(engines), [&](const Engine_t *e) { return name == e->name; });
+    if (engine == end(engines)) {
+      fprintf(stderr, "Unknown engine %s, engines are:", name.c_str());
+      for (const Engine_t *e : engines) fprintf(stderr, " %s", e->name);
+      fprintf(stderr, "\n");
+      exit(EXIT_FAILURE);
+    }
+    chosen.push_back(*engine);
+  }
+  if (chosen.empty()) chosen.assign(begin(engines), end(engines));
+
+  vector<Mix_t> mixes;
+  for (const string &item : split_list(mix_list)) {
+    Mix_t mix;
+    if (sscanf(item.c_str(), "%d/%d/%d", &mix.lookup, &mix.insert, &mix.remove) != 3 || mix.lookup < 0 ||
+        mix.insert < 0 || mix.remove < 0 || mix.lookup + mix.insert + mix.remove != 100) {
+      fprintf(stderr, "Mix %s must be lookup/insert/delete percentages adding up to 100\n", item.c_str());
+      exit(EXIT_FAILURE);
+    }
+    mixes.push_back(mix);
+  }
+
+  vector<string> distributions = split_list(distribution_list);
+  Zipfian_t zipfian = {};
+  for (const string &distribution : distributions) {
+    if (distribution == "zipfian") {
+      zipfian = zipfian_init(num_keys, theta);
+    } else if (distribution != "uniform") {
+      fprintf(stderr, "Unknown distribution %s, must be uniform or zipfian\n", distribution.c_str());
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // 1, 2, 4, ... threads, ending on max_threads even if it isn't a power of two
+  vector<int> thread_counts;
+  for (int threads = 1; threads < max_threads; threads *= 2) thread_counts.push_back(threads);
+  thread_counts.push_back(max_threads);
+
+  cout << "Keys: " << num_keys << ", seconds per run: " << duration << ", Zipfian theta: " << theta << '\n';
+  cout << "Engine              Mix       Distribution  Threads  Mops/s    Fairness  p50(ns)  p99(ns)  p99.9(ns)\n";
+  for (const Engine_t *engine : chosen) {
+    for (const string &distribution : distributions) {
+      for (Mix_t mix : mixes) {
+        for (int threads : thread_counts) {
+          RunResult_t result = run_mix(engine, mix, distribution == "zipfian" ? &zipfian : nullptr, num_keys,
+                                       threads, duration);
+          string mix_name = to_string(mix.lookup) + "/" + to_string(mix.insert) + "/" + to_string(mix.remove);
+          cout << left << setw(20) << engine->name << setw(10) << mix_name << setw(14) << distribution << right
+               << setw(7) << threads << "  " << fixed << setprecision(3) << setw(8) << result.mops << "  "
+               << setprecision(2) << setw(8) << result.fairness << "  " << setprecision(0) << setw(7) << result.p50
+               << "  " << setw(7) << result.p99 << "  " << setw(9) << result.p999 << endl;
+        }
+      }
+    }
+  }
+  return 0;
+}
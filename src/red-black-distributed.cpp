@@ -0,0 +1,165 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <iomanip>
+#include <climits>
+#include <unistd.h>
+#include <mpi.h>
+#include "distributed-tree.h"
+
+using namespace std;
+
+/******************************************************************************/
+/*                      DISTRIBUTED TREE BENCHMARK                            */
+/******************************************************************************/
+/*   Every rank inserts its own random keys into a distributed tree, looks     */
+/*   them up, rebalances the shards, looks them up again and deletes half of   */
+/*   them, timing each phase over all ranks. Run with e.g.                     */
+/*       mpirun -n 4 ./red-black-distributed -n 2                             */
+/*   With -d skewed the keys crowd into the bottom eighth of the key space, so */
+/*   before rebalancing almost all of them land on rank 0.                     */
+/******************************************************************************/
+
+// Runs fn on every rank at once, returns the slowest rank's time in seconds
+template <typename Function>
+static double timed(Function fn) {
+  MPI_Barrier(MPI_COMM_WORLD);
+  double start = MPI_Wtime();
+  fn();
+  double elapsed = MPI_Wtime() - start, slowest;
+  MPI_Allreduce(&elapsed, &slowest, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  return slowest;
+}
+
+// Prints every shard's size on rank 0
+static void print_shards(DistributedTree_t tree) {
+  unsigned long long size = tree->shard_size;
+  vector<unsigned long long> sizes(tree->num_ranks);
+  MPI_Gather(&size, 1, MPI_UNSIGNED_LONG_LONG, sizes.data(), 1, MPI_UNSIGNED_LONG_LONG, 0, tree->comm);
+  double skew = distributed_skew(tree);
+  if (tree->rank) return;
+  cout << "Shard sizes:";
+  for (unsigned long long s : sizes) cout << ' ' << s;
+  cout << " (skew " << fixed << setprecision(2) << skew << ")\n";
+}
+
+// Adds up a count over all ranks
+static unsigned long long sum_ranks(unsigned long long count) {
+  unsigned long long total;
+  MPI_Allreduce(&count, &total, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+  return total;
+}
+
+int main(int argc, char *argv[]) {
+  int provided;
+  // Only the main thread of each rank calls MPI
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+  int rank, num_ranks;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+  int keys_per_rank = 1000000;
+  int num_threads = 1;
+  int batch_size = 8;
+  double max_skew = 1.25;
+  bool skewed = false;
+  bool correctness = false;
+  bool use_node_pool = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "k:n:b:r:d:cp")) != -1) {
+    switch (opt) {
+      case 'k':
+        keys_per_rank = atoi(optarg);
+        break;
+      case 'n':
+        num_threads = atoi(optarg);
+        break;
+      case 'b':
+        batch_size = atoi(optarg);
+        break;
+      case 'r':
+        max_skew = atof(optarg);
+        break;
+      case 'd':
+        skewed = string(optarg) == "skewed";
+        break;
+      case 'c':
+        correctness = true;
+        break;
+      case 'p':
+        use_node_pool = true;
+        break;
+      default:
+        if (!rank) {
+          fprintf(stderr, "Usage: mpirun -n <ranks> %s [-k keys_per_rank] [-n threads_per_rank] [-b batch_size]\n",
+                  argv[0]);
+          fprintf(stderr, "          [-r max_skew] [-d uniform|skewed] [-c] [-p]\n");
+        }
+        MPI_Finalize();
+        exit(EXIT_FAILURE);
+    }
+  }
+
+  // Twice as many possible keys as keys, so some of them collide
+  int max_key = min<long long>(INT_MAX, 2LL * keys_per_rank * num_ranks);
+  mt19937 rng(rank + 1);
+  uniform_int_distribution<int> key(0, skewed ? max_key / 8 : max_key);
+  vector<int> keys(keys_per_rank);
+  for (int &k : keys) k = key(rng);
+
+  DistributedTree_t tree = distributed_init(MPI_COMM_WORLD, 0, max_key, num_threads, batch_size, use_node_pool);
+  if (!rank) {
+    cout << "Ranks: " << num_ranks << ", threads per rank: " << num_threads << ", keys per rank: " << keys_per_rank
+         << (skewed ? " (skewed)" : " (uniform)") << '\n';
+  }
+  double total_keys = (double)keys_per_rank * num_ranks;
+  auto report = [&](const char *phase, double seconds) {
+    if (!rank) {
+      cout << left << setw(28) << phase << right << fixed << setprecision(6) << seconds << " sec, " << setprecision(3)
+           << total_keys / seconds / 1e6 << " Mops/s\n";
+    }
+  };
+
+  size_t inserted = 0, found = 0, found_again = 0, deleted = 0;
+  report("Insert time:", timed([&] { inserted = distributed_insert(tree, keys); }));
+  print_shards(tree);
+  report("Lookup time:", timed([&] { found = distributed_lookup(tree, keys); }));
+
+  size_t moved = 0;
+  double rebalance_time = timed([&] { moved = distributed_rebalance(tree, max_skew); });
+  if (!rank) {
+    cout << left << setw(28) << "Rebalance time:" << right << fixed << setprecision(6) << rebalance_time << " sec, "
+         << moved << " keys moved\n";
+  }
+  print_shards(tree);
+  report("Lookup time (rebalanced):", timed([&] { found_again = distributed_lookup(tree, keys); }));
+
+  span<const int> half(keys.data(), keys.size() / 2);
+  report("Delete time (half):", timed([&] { deleted = distributed_delete(tree, half); }));
+
+  if (correctness) {
+    // Every rank's keys were all found, and the tree holds exactly the distinct
+    // keys inserted less the ones deleted
+    unsigned long long all_inserted = sum_ranks(inserted), all_deleted = sum_ranks(deleted);
+    bool all_found = sum_ranks(found) == total_keys && sum_ranks(found_again) == total_keys;
+    size_t size = distributed_size(tree);
+    bool valid = distributed_validate(tree);
+    if (!rank) {
+      if (!all_found) cout << "Some inserted keys weren't found!\n";
+      if (size != all_inserted - all_deleted) {
+        cout << "Tree holds " << size << " keys, expected " << all_inserted - all_deleted << "!\n";
+      }
+      if (!valid) cout << "A shard is invalid or holds keys it doesn't own!\n";
+      if (!all_found || size != all_inserted - all_deleted || !valid) {
+        distributed_free(tree);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+      }
+    }
+  }
+
+  distributed_free(tree);
+  if (!rank) cout << "Success.\n";
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,411 @@
+#ifndef RED_BLACK_HAND_OVER_HAND_H
+#define RED_BLACK_HAND_OVER_HAND_H
+
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+#include <initializer_list>
+#include "tree-common.h"
+
+using namespace std;
+
+/******************************************************************************/
+/*                        HAND-OVER-HAND LOCKED TREE                          */
+/******************************************************************************/
+/*   A fine-grained locking baseline for the lock-free tree: the same         */
+/*   top-down insert and delete as red-black-top-down-impl.h, but every node  */
+/*   has a mutex and a thread only reads or writes a node while holding it.   */
+/*   Going down, the next node is locked before the ones above the window a   */
+/*   rotation may relink are let go, so threads follow each other down the    */
+/*   tree and only wait for one another where their paths still overlap.     */
+/*   Locks are only ever taken on a child while holding its parent (the head  */
+/*   sentinel stands above the root), and a node's parent only changes under  */
+/*   a thread holding both, so waiting always points down the tree and can't  */
+/*   deadlock.                                                                */
+/******************************************************************************/
+
+template <typename Key>
+struct LockedNode {
+  LockedNode *child[2];
+  Key key;
+  bool red;
+  mutex lock;
+};
+
+template <typename Key, typename Compare = less<Key>>
+struct HandOverHandTree {
+  typedef LockedNode<Key> *Node;
+
+  // Sentinel whose left child is the root, locked to get at the root
+  LockedNode<Key> head;
+  [[no_unique_address]] Compare compare;
+};
+
+// The int set the benchmarks use
+typedef HandOverHandTree<int> *HandOverHandTree_t;
+
+// Hand-Over-Hand Tree Functions
+template <typename Key = int, typename Compare = less<Key>>
+HandOverHandTree<Key, Compare> *tree_init(Compare compare = Compare());
+template <typename Key, typename Compare>
+void tree_free(HandOverHandTree<Key, Compare> *&tree);
+template <typename Key, typename Compare>
+bool tree_insert(HandOverHandTree<Key, Compare> *tree, Arg<Key> key);
+template <typename Key, typename Compare>
+bool tree_delete(HandOverHandTree<Key, Compare> *tree, Arg<Key> key);
+template <typename Key, typename Compare>
+bool tree_lookup(HandOverHandTree<Key, Compare> *tree, Arg<Key> key);
+template <typename Key, typename Compare>
+size_t tree_size(HandOverHandTree<Key, Compare> *tree);
+template <typename Key, typename Compare>
+bool tree_validate(HandOverHandTree<Key, Compare> *tree);
+
+/******************************************************************************/
+/*                             DEFINITIONS                                    */
+/******************************************************************************/
+
+template <typename Key, typename Compare>
+HandOverHandTree<Key, Compare> *tree_init(Compare compare) {
+  HandOverHandTree<Key, Compare> *tree = new HandOverHandTree<Key, Compare>();
+  tree->head.child[0] = tree->head.child[1] = nullptr;
+  tree->head.red = false;
+  tree->compare = compare;
+  return tree;
+}
+
+template <typename Key>
+void free_nodes(LockedNode<Key> *node) {
+  if (!node) return;
+  free_nodes(node->child[0]);
+  free_nodes(node->child[1]);
+  delete node;
+}
+
+// Frees the tree and every node, no thread may be using it
+template <typename Key, typename Compare>
+void tree_free(HandOverHandTree<Key, Compare> *&tree) {
+  free_nodes(tree->head.child[0]);
+  delete tree;
+  tree = nullptr;
+}
+
+// Empty children count as black
+template <typename Key>
+inline bool is_red(LockedNode<Key> *node) {
+  return node && node->red;
+}
+
+// Returns which child of other key lies under (1 for right), setting equal if it's other's key
+template <typename Key, typename Compare>
+inline int key_direction(HandOverHandTree<Key, Compare> *tree, Arg<Key> key, Arg<Key> other, bool &equal) {
+  bool right = tree->compare(other, key);
+  bool left = tree->compare(key, other);
+  equal = !(left | right);
+  return right;
+}
+
+// Makes replacement the child of parent that child was (the head's child is the root)
+template <typename Key>
+inline void replace_child(LockedNode<Key> *parent, LockedNode<Key> *child, LockedNode<Key> *replacement) {
+  parent->child[parent->child[1] == child] = replacement;
+}
+
+// Rotates the subtree at root (a child of parent) in direction dir, returns the
+// node that took its place. The caller holds parent, root and the rising child.
+template <typename Key>
+LockedNode<Key> *rotateDir(LockedNode<Key> *parent, LockedNode<Key> *root, int dir) {
+  LockedNode<Key> *rotatingChild = root->child[1-dir];
+  root->child[1-dir] = rotatingChild->child[dir];
+  rotatingChild->child[dir] = root;
+  replace_child(parent, root, rotatingChild);
+  return rotatingChild;
+}
+
+/******************************************************************************/
+/*                              LOCAL AREA                                    */
+/******************************************************************************/
+/*   The nodes a thread holds, as in the lock-free tree's local area of       */
+/*   flagged nodes, grown by one node at a time on the way down and shrunk    */
+/*   back to the window the next step needs.                                  */
+/******************************************************************************/
+
+// Locks node (unless null or already held), which must be a child of a held node
+template <typename Key>
+inline void hold(vector<LockedNode<Key> *> &held, LockedNode<Key> *node) {
+  if (!node || find(held.begin(), held.end(), node) != held.end()) return;
+  node->lock.lock();
+  held.push_back(node);
+}
+
+// Unlocks every held node except the ones in keep
+template <typename Key>
+void release_except(vector<LockedNode<Key> *> &held, initializer_list<LockedNode<Key> *> keep) {
+  size_t kept = 0;
+  for (LockedNode<Key> *node : held) {
+    if (find(keep.begin(), keep.end(), node) != keep.end()) {
+      held[kept++] = node;
+    } else {
+      node->lock.unlock();
+    }
+  }
+  held.resize(kept);
+}
+
+template <typename Key>
+void release_all(vector<LockedNode<Key> *> &held) {
+  for (LockedNode<Key> *node : held) node->lock.unlock();
+  held.clear();
+}
+
+// Inserts key into the tree, returns true if it wasn't already present
+template <typename Key, typename Compare>
+bool tree_insert(HandOverHandTree<Key, Compare> *tree, Arg<Key> key) {
+  typedef LockedNode<Key> *Node;
+  // Reused across calls so inserting doesn't allocate anything but the new node
+  static thread_local vector<Node> path, held;
+
+  hold(held, &tree->head);
+  if (!tree->head.child[0]) {
+    Node root = new LockedNode<Key>();
+    root->child[0] = root->child[1] = nullptr;
+    root->key = key;
+    root->red = false;
+    tree->head.child[0] = root;
+    release_all(held);
+    return true;
+  }
+
+  // Search path from the head down to the current node, whose last four nodes
+  // (all a rotation relinks) are held
+  path.assign({&tree->head, tree->head.child[0]});
+  hold(held, path.back());
+  bool inserted = false;
+
+  while (true) {
+    Node node = path.back();
+
+    // Node has two red children, swap colors with them
+    Node left = node->child[0], right = node->child[1];
+    hold(held, left);
+    hold(held, right);
+    if (is_red(left) && is_red(right)) {
+      node->red = true;
+      left->red = false;
+      right->red = false;
+      // Root always stays black
+      if (path.size() == 2) {
+        node->red = false;
+      }
+    }
+
+    // Node and parent both red, rotate at the grandparent
+    // (a red parent is never the root, so the grandparent isn't the head)
+    size_t depth = path.size();
+    if (depth >= 4 && node->red && path[depth - 2]->red) {
+      Node parent = path[depth - 2];
+      Node grandparent = path[depth - 3];
+      int dir = parent == grandparent->child[1];
+      if (node == parent->child[dir]) {
+        // Node is an outer child, a single rotation lifts parent above grandparent
+        rotateDir(path[depth - 4], grandparent, 1-dir);
+        parent->red = false;
+        grandparent->red = true;
+        path.erase(path.end() - 3);
+      } else {
+        // Node is an inner child, a double rotation lifts node above both
+        rotateDir(grandparent, parent, dir);
+        rotateDir(path[depth - 4], grandparent, 1-dir);
+        node->red = false;
+        grandparent->red = true;
+        path.erase(path.end() - 3, path.end() - 1);
+      }
+    }
+
+    // Either the key was already present or we just fixed up the new node
+    bool equal;
+    int dir = key_direction(tree, key, node->key, equal);
+    if (equal) {
+      break;
+    }
+
+    // Step down, creating the new node if we fell off the tree. Node's
+    // children (old or rotated in) are all held already.
+    Node next = node->child[dir];
+    if (!next) {
+      next = new LockedNode<Key>();
+      next->child[0] = next->child[1] = nullptr;
+      next->key = key;
+      next->red = true;
+      hold(held, next);
+      node->child[dir] = next;
+      inserted = true;
+    }
+    path.push_back(next);
+    depth = path.size();
+    Node great_grandparent = depth >= 4 ? path[depth - 4] : nullptr;
+    release_except(held, {great_grandparent, path[depth - 3], path[depth - 2], next});
+  }
+  release_all(held);
+  return inserted;
+}
+
+// Deletes key from the tree, returns true if it was present
+template <typename Key, typename Compare>
+bool tree_delete(HandOverHandTree<Key, Compare> *tree, Arg<Key> key) {
+  typedef LockedNode<Key> *Node;
+  static thread_local vector<Node> held;
+
+  hold(held, &tree->head);
+  Node head = &tree->head, node = head->child[0];
+  if (!node) {
+    release_all(held);
+    return false;
+  }
+  hold(held, node);
+
+  // The grandparent is only used once parent is below the head
+  Node grandparent = nullptr, parent = head;
+  // Node holding key, which takes over its predecessor's key. Stays held until
+  // then, so no other thread gets past it in the meantime.
+  Node found = nullptr;
+  int last = 0;
+
+  while (true) {
+    // Once key is found, keep going left then right to its in-order predecessor
+    bool equal;
+    int dir = key_direction(tree, key, node->key, equal);
+    if (equal) {
+      found = node;
+    }
+    hold(held, node->child[0]);
+    hold(held, node->child[1]);
+
+    // Push the red node down
+    if (!is_red(node) && !is_red(node->child[dir])) {
+      if (is_red(node->child[1-dir])) {
+        // Red child on the far side, rotate it above node
+        Node red_child = rotateDir(parent, node, dir);
+        node->red = true;
+        red_child->red = false;
+        parent = red_child;
+      } else if (parent != head) {
+        Node sibling = parent->child[1-last];
+        hold(held, sibling);
+        if (sibling) {
+          Node close_nephew = sibling->child[last];
+          Node distant_nephew = sibling->child[1-last];
+          hold(held, close_nephew);
+          hold(held, distant_nephew);
+          if (!is_red(close_nephew) && !is_red(distant_nephew)) {
+            // Both nephews black, swap colors with parent
+            parent->red = false;
+            sibling->red = true;
+            node->red = true;
+          } else {
+            // A red nephew, rotate it (or the sibling) above parent
+            if (is_red(close_nephew)) {
+              rotateDir(parent, sibling, 1-last);
+            }
+            Node top = rotateDir(grandparent, parent, last);
+            node->red = true;
+            top->red = true;
+            top->child[0]->red = false;
+            top->child[1]->red = false;
+            // Root always stays black
+            if (grandparent == head) {
+              top->red = false;
+            }
+          }
+        }
+      }
+    }
+
+    Node next = node->child[dir];
+    if (!next) {
+      break;
+    }
+
+    // Step down, keeping the window a rotation may relink
+    grandparent = parent;
+    parent = node;
+    node = next;
+    last = dir;
+    release_except(held, {grandparent, parent, node, found});
+  }
+
+  if (!found) {
+    release_all(held);
+    return false;
+  }
+
+  // Unlink the predecessor (now red, or the root) which has at most one child,
+  // after handing its key to the node being deleted. Nobody else can be waiting
+  // for it, as they would have to be holding parent.
+  Node child = node->child[node->child[0] == nullptr];
+  replace_child(parent, node, child);
+  if (child && parent == head) child->red = false;
+  if (found != node) {
+    found->key = std::move(node->key);
+  }
+  release_all(held);
+  delete node;
+  return true;
+}
+
+// Return whether key is in the tree, locking each node on the way down before
+// letting go of its parent
+template <typename Key, typename Compare>
+bool tree_lookup(HandOverHandTree<Key, Compare> *tree, Arg<Key> key) {
+  LockedNode<Key> *parent = &tree->head;
+  parent->lock.lock();
+  LockedNode<Key> *node = parent->child[0];
+  while (node) {
+    node->lock.lock();
+    parent->lock.unlock();
+    bool equal;
+    int dir = key_direction(tree, key, node->key, equal);
+    if (equal) {
+      node->lock.unlock();
+      return true;
+    }
+    parent = node;
+    node = node->child[dir];
+  }
+  parent->lock.unlock();
+  return false;
+}
+
+template <typename Key>
+size_t subtree_size(LockedNode<Key> *node) {
+  return node ? 1 + subtree_size(node->child[0]) + subtree_size(node->child[1]) : 0;
+}
+
+// Number of keys in the tree, no thread may be changing it
+template <typename Key, typename Compare>
+size_t tree_size(HandOverHandTree<Key, Compare> *tree) {
+  return subtree_size(tree->head.child[0]);
+}
+
+// Black height of the subtree at node, or -1 if it breaks a red-black rule or
+// holds a key outside (lo, hi)
+template <typename Key, typename Compare>
+int validate_subtree(HandOverHandTree<Key, Compare> *tree, LockedNode<Key> *node, const Key *lo, const Key *hi) {
+  if (!node) return 1;
+  if ((lo && !tree->compare(*lo, node->key)) || (hi && !tree->compare(node->key, *hi))) return -1;
+  if (node->red && (is_red(node->child[0]) || is_red(node->child[1]))) return -1;
+  int left = validate_subtree(tree, node->child[0], lo, &node->key);
+  int right = validate_subtree(tree, node->child[1], &node->key, hi);
+  if (left < 0 || left != right) return -1;
+  return left + !node->red;
+}
+
+// Returns whether the tree is ordered, has a black root and red-black balance,
+// no thread may be changing it
+template <typename Key, typename Compare>
+bool tree_validate(HandOverHandTree<Key, Compare> *tree) {
+  LockedNode<Key> *root = tree->head.child[0];
+  return !is_red(root) && validate_subtree(tree, root, (const Key *)nullptr, (const Key *)nullptr) >= 0;
+}
+
+#endif
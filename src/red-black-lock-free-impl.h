@@ -0,0 +1,1439 @@
+#include <stdio.h>
+#include <omp.h>
+#include <memory>
+
+// The following code was inspired and partially sourced from:
+// https://github.com/zhangshun97/Lock-free-Red-black-tree/
+
+using namespace std;
+
+template <typename Key, typename Value, typename Compare>
+inline RedBlackNode<Key, Value> *newTreeNode(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Arg<Value> value,
+                                             bool red, typename RedBlackTree<Key, Value, Compare>::Node parent,
+                                             typename RedBlackTree<Key, Value, Compare>::Node left,
+                                             typename RedBlackTree<Key, Value, Compare>::Node right) {
+  typedef RedBlackNode<Key, Value> Node;
+  return tree->pool ? new (pool_alloc(tree->pool)) Node{{left, right}, parent, key, value, 0, false, red, false, 1}
+                    : new Node{{left, right}, parent, key, value, 0, false, red, false, 1};
+}
+
+// Frees a node allocated by newTreeNode for a tree with the given pool
+// (type-erased so the epoch code can hold nodes of any tree)
+template <typename Key, typename Value>
+void free_tree_node(NodePool_t pool, void *node) {
+  RedBlackNode<Key, Value> *tree_node = (RedBlackNode<Key, Value> *)node;
+  if (pool) {
+    destroy_at(tree_node);
+    pool_free(pool, tree_node);
+  } else {
+    delete tree_node;
+  }
+}
+
+// Returns which side of other key belongs on through the tree's Compare (1 for
+// the right), setting equal if they are the same key. Both comparisons are always
+// made so searches only branch on the (rarely true) equal case.
+template <typename Key, typename Value, typename Compare>
+inline int key_direction(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Arg<Key> other, bool &equal) {
+  bool right = tree->compare(other, key);
+  bool left = tree->compare(key, other);
+  equal = !(left | right);
+  return right;
+}
+
+// Size of the subtree rooted at node, for trees with order statistics
+template <typename Key, typename Value>
+inline int node_size(RedBlackNode<Key, Value> *node) {
+  return node ? node->size.load(memory_order_relaxed) : 0;
+}
+
+// Adds delta to the size of node, which the caller has in its local area
+template <typename Key, typename Value, typename Compare>
+inline void add_to_size(RedBlackTree<Key, Value, Compare> *&tree, RedBlackNode<Key, Value> *node, int delta) {
+  if (tree->order_statistics) {
+    node->size.store(node->size.load(memory_order_relaxed) + delta, memory_order_relaxed);
+  }
+}
+
+// Number of locks writers of a tree with order statistics hash their keys onto
+#define KEY_LOCKS 256
+
+// Lock taken by writers of key in a tree with order statistics. Inserts and
+// deletes count themselves in every node on their way down, before they know
+// whether key is in the tree, so they first check under this lock that they will
+// go through with it. Keys that can't be hashed all share one lock.
+template <typename Key, typename Value, typename Compare>
+inline atomic<bool> &key_lock(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key) {
+  if constexpr (is_default_constructible<hash<Key>>::value) {
+    return tree->key_locks[hash<Key>()(key) % KEY_LOCKS];
+  } else {
+    return tree->key_locks[0];
+  }
+}
+
+template <typename Key, typename Value, typename Compare>
+void lock_key(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key) {
+  atomic<bool> &lock = key_lock(tree, key);
+  Backoff_t backoff = {0};
+  bool expected = false;
+  while (!lock.compare_exchange_weak(expected, true, memory_order_acquire)) {
+    TREE_STAT(cas_failures, 1);
+    do {
+      backoff_wait(backoff);
+    } while (lock.load(memory_order_relaxed));
+    expected = false;
+  }
+}
+
+template <typename Key, typename Value, typename Compare>
+void unlock_key(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key) {
+  key_lock(tree, key).store(false, memory_order_release);
+}
+
+// Executes Rotation of the subtree of tree at root in direction dir
+// The caller must have root, its parent (the head if root is the tree's root) and the rising child
+// in its local area
+template <typename Key, typename Value, typename Compare>
+RedBlackNode<Key, Value> *rotateDir(RedBlackTree<Key, Value, Compare> *&tree,
+                                    RedBlackNode<Key, Value> *root, int dir) {
+  typedef RedBlackNode<Key, Value> *Node;
+  Node parent = root->parent;
+  Node rotatingChild = root->child[1-dir];
+  // assert(rotatingChild);
+  Node C = rotatingChild->child[dir];
+  TREE_STAT(rotations, 1);
+
+  // All three nodes whose children change are marked for concurrent lookups
+  begin_modify(parent);
+  begin_modify(root);
+  begin_modify(rotatingChild);
+
+  root->child[1-dir] = C;
+  if (C) {
+    C->parent = root;
+  }
+  rotatingChild->child[dir] = root;
+
+  root->parent = rotatingChild;
+  rotatingChild->parent = parent;
+  parent->child[root == parent->child[1]] = rotatingChild;
+
+  // The rising child takes over the whole subtree, root gives up the part that
+  // stayed with the rising child. Written as a difference rather than summed up
+  // from the children, so it's also right while an insert or delete that has
+  // counted itself in root hasn't reached root's children yet.
+  if (tree->order_statistics) {
+    int root_size = node_size(root);
+    root->size.store(root_size - node_size(rotatingChild) + node_size(C), memory_order_relaxed);
+    rotatingChild->size.store(root_size, memory_order_relaxed);
+  }
+
+  end_modify(rotatingChild);
+  end_modify(root);
+  end_modify(parent);
+  return rotatingChild;
+}
+
+// Initializes an empty tree, whose nodes come from a per-thread node pool if
+// use_node_pool is set (and from new/delete otherwise) and keep their subtree
+// sizes if order_statistics is set
+template <typename Key, typename Value, typename Compare>
+RedBlackTree<Key, Value, Compare> *tree_init(bool use_node_pool, bool order_statistics, Compare compare) {
+  RedBlackTree<Key, Value, Compare> *tree = new RedBlackTree<Key, Value, Compare>();
+  tree->pool = use_node_pool ? pool_init(sizeof(RedBlackNode<Key, Value>)) : nullptr;
+  tree->order_statistics = order_statistics;
+  tree->key_locks = order_statistics ? new atomic<bool>[KEY_LOCKS]() : nullptr;
+  tree->compare = compare;
+  return tree;
+}
+
+// Subtrees rooted this many levels below the root are freed by their own task
+#define FREE_TASK_DEPTH 8
+
+// Frees every node of the subtree rooted at node (at the given depth), nodes
+// from a pool are only destroyed since the pool releases their memory
+template <typename Key, typename Value>
+void free_subtree(RedBlackNode<Key, Value> *node, int depth, NodePool_t pool) {
+  if (!node) return;
+  RedBlackNode<Key, Value> *left = node->child[0], *right = node->child[1];
+  if (depth < FREE_TASK_DEPTH) {
+    #pragma omp task
+    free_subtree(left, depth + 1, pool);
+  } else {
+    free_subtree(left, depth + 1, pool);
+  }
+  free_subtree(right, depth + 1, pool);
+  if (pool) {
+    destroy_at(node);
+  } else {
+    delete node;
+  }
+}
+
+// Frees the tree and all of its nodes, tearing large trees down with num_threads
+// threads. No other thread may be using the tree (nodes deleted from it earlier
+// may still be awaiting reclamation, they are freed as usual)
+template <typename Key, typename Value, typename Compare>
+void tree_free(RedBlackTree<Key, Value, Compare> *&tree, int num_threads) {
+  // Pooled nodes with nothing to destroy go with the pool's slabs, all at once
+  if (!tree->pool || !is_trivially_destructible<RedBlackNode<Key, Value>>::value) {
+    RedBlackNode<Key, Value> *root = tree->head.child[0];
+    #pragma omp parallel num_threads(num_threads)
+    #pragma omp single
+    free_subtree(root, 0, tree->pool);
+  }
+  if (tree->pool) {
+    pool_destroy(tree->pool);
+  }
+  delete[] tree->key_locks;
+  delete tree;
+  tree = nullptr;
+}
+
+// Returns the number of nodes in the tree and the memory it holds (not counting
+// memory owned by the keys and values themselves), walks the whole tree like
+// tree_size
+template <typename Key, typename Value, typename Compare>
+TreeMemory_t tree_memory(RedBlackTree<Key, Value, Compare> *&tree) {
+  TreeMemory_t memory;
+  memory.nodes = tree_size(tree);
+  memory.bytes = sizeof(RedBlackTree<Key, Value, Compare>);
+  memory.bytes += tree->pool ? pool_bytes(tree->pool) : memory.nodes * sizeof(RedBlackNode<Key, Value>);
+  memory.bytes += tree->key_locks ? KEY_LOCKS * sizeof(atomic<bool>) : 0;
+  memory.bytes_per_key = memory.nodes ? (double)memory.bytes / memory.nodes : 0;
+  return memory;
+}
+
+// Create a string representatino of a subtree
+// Of the form str = Empty | RED(str, x, str) | BLACK(str, x, str)
+template <typename Key, typename Value>
+string subtree_to_string(RedBlackNode<Key, Value> *root) {
+  if (!root) {
+    return "Empty";
+  }
+  if (root->red)
+    return "RED(" + subtree_to_string(root->child[0].load()) + ", " + key_to_string(root->key) + ", "
+                  + subtree_to_string(root->child[1].load()) + ")";
+  else
+    return "BLACK(" + subtree_to_string(root->child[0].load()) + ", " + key_to_string(root->key) + ", "
+                    + subtree_to_string(root->child[1].load()) + ")";
+}
+
+// Create a String representation of a Tree
+template <typename Key, typename Value, typename Compare>
+string tree_to_string(RedBlackTree<Key, Value, Compare> *T) {
+  return subtree_to_string(T->head.child[0].load());
+}
+
+template <typename Key, typename Value>
+void inord_tree_to_vec_helper(RedBlackNode<Key, Value> *T, vector <Key> &res) {
+  if (!T) return;
+  inord_tree_to_vec_helper(T->child[0].load(), res);
+  res.push_back(T->key);
+  inord_tree_to_vec_helper(T->child[1].load(), res);
+}
+
+// With function above, returns an in-order vector of all elements of the tree
+template <typename Key, typename Value, typename Compare>
+vector <Key> tree_to_vector(RedBlackTree<Key, Value, Compare> *&T) {
+  RedBlackNode<Key, Value> *root = T->head.child[0];
+  vector <Key> res;
+  if (!root) return res;
+
+  inord_tree_to_vec_helper(root, res);
+
+  return res;
+}
+
+// Returns the size of a subtree rooted at root
+template <typename Key, typename Value>
+int subtree_size(RedBlackNode<Key, Value> *root) {
+  if (!root) return 0;
+  return 1 + subtree_size(root->child[0].load()) + subtree_size(root->child[1].load());
+}
+
+// Returns the size of the tree overall
+template <typename Key, typename Value, typename Compare>
+int tree_size(RedBlackTree<Key, Value, Compare> *&tree) {
+  return subtree_size(tree->head.child[0].load());
+}
+
+// Return Whether Red-Black Tree Rooted at root is valid
+// If it is valid, also return the number of black nodes to any Empty,
+// including this info allows validation to be written recursively
+template <typename Key, typename Value, typename Compare>
+bool validateAtBlackDepth(RedBlackTree<Key, Value, Compare> *&tree, RedBlackNode<Key, Value> *root,
+                          int *blackDepth, const Key *lo, const Key *hi) {
+  // (Base Case) Leaves are Valid
+  if (!root) {
+    *blackDepth = 0;
+    return true;
+  }
+
+  // Root must follow BST invariant
+  if ((lo && !tree->compare(*lo, root->key)) || (hi && !tree->compare(root->key, *hi))) {
+    printf("BST Invariant Failed at %s! \n", key_to_string(root->key).c_str());
+    return false;
+  }
+
+  // Red Nodes Cannot have Red Children
+  RedBlackNode<Key, Value> *left = root->child[0], *right = root->child[1];
+  if (root->red && ((left && left->red) || (right && right->red))) {
+    printf("Red Children Invariant Failed at %s! \n", key_to_string(root->key).c_str());
+    return false;
+  }
+
+  // Children Must Point back to their Parents
+  if ((left && left->parent != root) || (right && right->parent != root)) {
+    printf("Orphaned Children at %s! \n", key_to_string(root->key).c_str());
+    return false;
+  }
+
+  // Left and right subtrees must be valid red-black trees
+  int leftDepth = 0, rightDepth = 0;
+  bool leftValid = validateAtBlackDepth(tree, left, &leftDepth, lo, &(root->key));
+  bool rightValid = validateAtBlackDepth(tree, right, &rightDepth, &(root->key), hi);
+
+  if (!leftValid || !rightValid) {
+    return false;
+  }
+
+  // Black depth must be the same for both children
+  if (leftDepth != rightDepth) {
+    printf("Black Depth Invariant Failed at %s! \n", key_to_string(root->key).c_str());
+    return false;
+  }
+
+  // Sizes must add up, if the tree keeps them
+  if (tree->order_statistics && root->size != node_size(left) + node_size(right) + 1) {
+    printf("Subtree Size Invariant Failed at %s! \n", key_to_string(root->key).c_str());
+    return false;
+  }
+
+  // Update blackdepth if necessary
+  *blackDepth = leftDepth + !(root->red);
+  return true;
+}
+
+// Return whether Red-Black Tree Rooted at root is valid
+template <typename Key, typename Value, typename Compare>
+bool tree_validate(RedBlackTree<Key, Value, Compare> *&tree) {
+  RedBlackNode<Key, Value> *root = tree->head.child[0];
+  if (root && root->parent != &tree->head) {
+    printf("Root isn't the head's child!\n");
+    return false;
+  }
+  int blackDepth = 0;
+  return validateAtBlackDepth(tree, root, &blackDepth, (const Key *)nullptr, (const Key *)nullptr);
+}
+
+
+// Null children count as black leaves
+template <typename Key, typename Value>
+inline bool is_red(RedBlackNode<Key, Value> *node) {
+  return node && node->red;
+}
+
+// A search that goes past the place a two-child delete moves a predecessor up
+// into can miss it, so searches only start while no such relocation is under way,
+// and only trust what they found if none began since. Fails if one is under way,
+// else sets relocations to check against with relocations_unchanged.
+template <typename Key, typename Value, typename Compare>
+inline bool relocation_snapshot(RedBlackTree<Key, Value, Compare> *&tree, unsigned int &relocations) {
+  if (tree->relocating.load(memory_order_acquire)) return false;
+  relocations = tree->relocations.load(memory_order_acquire);
+  return true;
+}
+
+// Whether no relocation is under way and none finished since relocation_snapshot.
+// A search that saw a node unlinked by a relocation sees it counted in relocating,
+// and once that count is back to zero, the relocation counted as finished.
+template <typename Key, typename Value, typename Compare>
+inline bool relocations_unchanged(RedBlackTree<Key, Value, Compare> *&tree, unsigned int relocations) {
+  return !tree->relocating.load(memory_order_acquire) &&
+         tree->relocations.load(memory_order_acquire) == relocations;
+}
+
+// Returns the node holding key, or null if key isn't in the tree. The caller
+// must be inside an epoch critical section for as long as it uses the node.
+// Lookups never write to the tree: each step reads a node's version, follows its
+// child pointer and then checks the version of the node it came from is still the
+// same. If anything on the way changed underneath, the search restarts.
+template <typename Key, typename Value, typename Compare>
+RedBlackNode<Key, Value> *lookup_node(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key) {
+  typedef RedBlackNode<Key, Value> *Node;
+  Backoff_t backoff = {0};
+  while (true) {
+    // Wait out a delete that is moving a node up past where we might be searching
+    unsigned int relocations;
+    if (!relocation_snapshot(tree, relocations)) {
+      restart_wait(backoff);
+      continue;
+    }
+
+    // The head plays the part of the first parent
+    atomic<unsigned int> *parent_version = &tree->head.version;
+    unsigned int seen_version = parent_version->load(memory_order_acquire);
+    if (seen_version & 1) {
+      restart_wait(backoff);
+      continue;
+    }
+    Node node = tree->head.child[0].load(memory_order_acquire);
+
+    bool restart = false;
+    while (node) {
+      unsigned int version = node->version.load(memory_order_acquire);
+      // Node reached from a parent that has changed since, or node being changed
+      atomic_thread_fence(memory_order_acquire);
+      if (parent_version->load(memory_order_relaxed) != seen_version || (version & 1)) {
+        restart = true;
+        break;
+      }
+      bool equal;
+      int dir = key_direction(tree, key, node->key, equal);
+      if (equal) {
+        return node;
+      }
+      parent_version = &node->version;
+      seen_version = version;
+      node = node->child[dir].load(memory_order_acquire);
+    }
+    if (restart) {
+      restart_wait(backoff);
+      continue;
+    }
+
+    // Fell off the tree, which only means key is absent if the last node didn't
+    // change and no node was moved up the tree in the meantime
+    atomic_thread_fence(memory_order_acquire);
+    if (parent_version->load(memory_order_relaxed) == seen_version &&
+        relocations_unchanged(tree, relocations)) {
+      return nullptr;
+    }
+    restart_wait(backoff);
+  }
+}
+
+// Return whether a node with given key exists in a Red-Black Tree
+template <typename Key, typename Value, typename Compare>
+bool tree_lookup(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key) {
+  epoch_enter();
+  bool found = lookup_node(tree, key) != nullptr;
+  epoch_exit();
+  return found;
+}
+
+// Where one search of a batch (see tree_lookup_batch) has got to, as in
+// lookup_node. A null parent_version means the search has to start (again) at the
+// head.
+template <typename Key, typename Value>
+struct LookupCursor {
+  RedBlackNode<Key, Value> *node;
+  atomic<unsigned int> *parent_version;
+  unsigned int seen_version;
+  unsigned int relocations;
+};
+
+enum LookupStep {
+  LOOKUP_FOUND,
+  LOOKUP_ABSENT,
+  LOOKUP_MOVED,
+  LOOKUP_RESTART
+};
+
+// One step of lookup_node's search for key from cursor, which leaves the node it
+// steps to prefetched for the next step
+template <typename Key, typename Value, typename Compare>
+LookupStep lookup_step(RedBlackTree<Key, Value, Compare> *&tree, LookupCursor<Key, Value> &cursor, Arg<Key> key) {
+  if (!cursor.parent_version) {
+    if (!relocation_snapshot(tree, cursor.relocations)) {
+      return LOOKUP_RESTART;
+    }
+    cursor.seen_version = tree->head.version.load(memory_order_acquire);
+    if (cursor.seen_version & 1) {
+      return LOOKUP_RESTART;
+    }
+    cursor.parent_version = &tree->head.version;
+    cursor.node = tree->head.child[0].load(memory_order_acquire);
+    __builtin_prefetch(cursor.node);
+    return LOOKUP_MOVED;
+  }
+
+  RedBlackNode<Key, Value> *node = cursor.node;
+  if (!node) {
+    // Fell off the tree, see lookup_node
+    atomic_thread_fence(memory_order_acquire);
+    if (cursor.parent_version->load(memory_order_relaxed) == cursor.seen_version &&
+        relocations_unchanged(tree, cursor.relocations)) {
+      return LOOKUP_ABSENT;
+    }
+    cursor.parent_version = nullptr;
+    return LOOKUP_RESTART;
+  }
+  unsigned int version = node->version.load(memory_order_acquire);
+  atomic_thread_fence(memory_order_acquire);
+  if (cursor.parent_version->load(memory_order_relaxed) != cursor.seen_version || (version & 1)) {
+    cursor.parent_version = nullptr;
+    return LOOKUP_RESTART;
+  }
+  bool equal;
+  int dir = key_direction(tree, key, node->key, equal);
+  if (equal) {
+    return LOOKUP_FOUND;
+  }
+  cursor.parent_version = &node->version;
+  cursor.seen_version = version;
+  cursor.node = node->child[dir].load(memory_order_acquire);
+  __builtin_prefetch(cursor.node);
+  return LOOKUP_MOVED;
+}
+
+// Looks up every key in keys, setting results[i] to whether keys[i] is in the
+// tree, returns how many were. LOOKUP_BATCH searches at a time go down the tree
+// in lockstep, a step of each in turn, so their cache misses on each level
+// overlap instead of being paid one after another. Each search validates its
+// steps like lookup_node and restarts on its own if a writer got in the way.
+template <typename Key, typename Value, typename Compare>
+size_t tree_lookup_batch(RedBlackTree<Key, Value, Compare> *&tree, const vector<Key> &keys, vector<bool> &results) {
+  LookupCursor<Key, Value> cursors[LOOKUP_BATCH];
+  bool searching[LOOKUP_BATCH];
+  size_t found = 0;
+  results.assign(keys.size(), false);
+  for (size_t start = 0; start < keys.size(); start += LOOKUP_BATCH) {
+    size_t count = min((size_t)LOOKUP_BATCH, keys.size() - start);
+    for (size_t i = 0; i < count; i++) {
+      cursors[i].parent_version = nullptr;
+      searching[i] = true;
+    }
+    Backoff_t backoff = {0};
+    size_t remaining = count;
+
+    epoch_enter();
+    while (remaining) {
+      bool moved = false;
+      for (size_t i = 0; i < count; i++) {
+        if (!searching[i]) continue;
+        LookupStep step = lookup_step(tree, cursors[i], keys[start + i]);
+        if (step == LOOKUP_FOUND || step == LOOKUP_ABSENT) {
+          results[start + i] = step == LOOKUP_FOUND;
+          found += step == LOOKUP_FOUND;
+          searching[i] = false;
+          remaining--;
+        }
+        moved |= step != LOOKUP_RESTART;
+      }
+      // Only back off once every search left is waiting on a writer
+      if (!moved) {
+        restart_wait(backoff);
+      }
+    }
+    epoch_exit();
+  }
+  return found;
+}
+
+// Copies node's value into value, returns false if node was deleted before then
+template <typename Key, typename Value>
+bool copy_value(RedBlackNode<Key, Value> *node, Value &value) {
+  if constexpr (is_trivially_copyable<Value>::value) {
+    // Values that can be copied byte by byte are read like the tree itself,
+    // again if tree_update changed it or tree_delete removed the node while we
+    // were copying
+    Backoff_t backoff = {0};
+    while (true) {
+      unsigned int version = node->version.load(memory_order_acquire);
+      if (!(version & 1)) {
+        value = node->value;
+        bool removed = node->removed;
+        atomic_thread_fence(memory_order_acquire);
+        if (node->version.load(memory_order_relaxed) == version) return !removed;
+      }
+      restart_wait(backoff);
+    }
+  } else {
+    // Anything else is copied under the node's flag, unless the node was
+    // deleted before we got it
+    flag_node(node);
+    if (node->removed) {
+      unflag_node(node);
+      return false;
+    }
+    value = node->value;
+    unflag_node(node);
+    return true;
+  }
+}
+
+// Copies the value stored with key into value, returns false if key isn't in the tree
+template <typename Key, typename Value, typename Compare>
+bool tree_find(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Value &value) {
+  epoch_enter();
+  while (true) {
+    RedBlackNode<Key, Value> *node = lookup_node(tree, key);
+    if (!node) {
+      epoch_exit();
+      return false;
+    }
+    // A deleted node means key has to be looked up again
+    if (!copy_value(node, value)) continue;
+    epoch_exit();
+    return true;
+  }
+}
+
+// Replaces the value stored with key in place, returns false if key isn't in the tree
+// Only the node's own flag is taken (and nothing else while it is held), so this
+// never waits on more than one insert or delete passing through the node
+template <typename Key, typename Value, typename Compare>
+bool tree_update(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Arg<Value> value) {
+  epoch_enter();
+  while (true) {
+    RedBlackNode<Key, Value> *node = lookup_node(tree, key);
+    if (!node) {
+      epoch_exit();
+      return false;
+    }
+
+    flag_node(node);
+    // Deleted before we got the flag, key may have been inserted again since
+    if (node->removed) {
+      unflag_node(node);
+      continue;
+    }
+    begin_modify(node);
+    node->value = value;
+    end_modify(node);
+    unflag_node(node);
+    epoch_exit();
+    return true;
+  }
+}
+
+// Returns how many keys in the tree are less than key (or not greater than key
+// if inclusive). With order statistics this is a search like lookup_node that
+// adds up the sizes of the subtrees it passes on its left, in O(log n); the count
+// may be off by the inserts and deletes still on their way down meanwhile.
+// Without, the keys are counted by a scan from the first one, in O(n).
+template <typename Key, typename Value, typename Compare>
+size_t rank_of(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, bool inclusive) {
+  typedef RedBlackNode<Key, Value> *Node;
+  if (!tree->order_statistics) {
+    size_t rank = 0;
+    TreeIterator<Key, Value> first = {};
+    if (tree_successor(tree, first)) {
+      tree_range(tree, first.key, key, [&](const Key &other, const Value &) {
+        rank += inclusive || tree->compare(other, key);
+      });
+    }
+    return rank;
+  }
+
+  Backoff_t backoff = {0};
+  epoch_enter();
+  while (true) {
+    unsigned int relocations;
+    if (!relocation_snapshot(tree, relocations)) {
+      restart_wait(backoff);
+      continue;
+    }
+
+    atomic<unsigned int> *parent_version = &tree->head.version;
+    unsigned int seen_version = parent_version->load(memory_order_acquire);
+    if (seen_version & 1) {
+      restart_wait(backoff);
+      continue;
+    }
+    Node node = tree->head.child[0].load(memory_order_acquire);
+
+    long rank = 0;
+    bool restart = false;
+    while (node) {
+      unsigned int version = node->version.load(memory_order_acquire);
+      atomic_thread_fence(memory_order_acquire);
+      if (parent_version->load(memory_order_relaxed) != seen_version || (version & 1)) {
+        restart = true;
+        break;
+      }
+      bool equal;
+      int dir = key_direction(tree, key, node->key, equal);
+      // Going right passes node and everything to its left
+      if (dir || equal) {
+        rank += node_size(node->child[0].load(memory_order_acquire)) + (dir || inclusive);
+      }
+      parent_version = &node->version;
+      seen_version = version;
+      node = equal ? nullptr : node->child[dir].load(memory_order_acquire);
+    }
+    if (restart) {
+      restart_wait(backoff);
+      continue;
+    }
+
+    atomic_thread_fence(memory_order_acquire);
+    if (parent_version->load(memory_order_relaxed) == seen_version &&
+        relocations_unchanged(tree, relocations)) {
+      epoch_exit();
+      return max(rank, 0L);
+    }
+    restart_wait(backoff);
+  }
+}
+
+// Returns how many keys in the tree are less than key
+template <typename Key, typename Value, typename Compare>
+size_t tree_rank(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key) {
+  return rank_of(tree, key, false);
+}
+
+// Sets key to the key with the given rank (the smallest has rank 0), returns false
+// if the tree doesn't have that many keys. Searches like rank_of.
+template <typename Key, typename Value, typename Compare>
+bool tree_select(RedBlackTree<Key, Value, Compare> *&tree, size_t rank, Key &key) {
+  typedef RedBlackNode<Key, Value> *Node;
+  if (!tree->order_statistics) {
+    TreeIterator<Key, Value> it = {};
+    bool found = tree_successor(tree, it);
+    for (; found && rank > 0; rank--) {
+      found = tree_successor(tree, it);
+    }
+    if (found) key = it.key;
+    return found;
+  }
+
+  Backoff_t backoff = {0};
+  epoch_enter();
+  while (true) {
+    unsigned int relocations;
+    if (!relocation_snapshot(tree, relocations)) {
+      restart_wait(backoff);
+      continue;
+    }
+
+    atomic<unsigned int> *parent_version = &tree->head.version;
+    unsigned int seen_version = parent_version->load(memory_order_acquire);
+    if (seen_version & 1) {
+      restart_wait(backoff);
+      continue;
+    }
+    Node node = tree->head.child[0].load(memory_order_acquire);
+
+    long remaining = rank;
+    Node selected = nullptr;
+    bool restart = false;
+    while (node) {
+      unsigned int version = node->version.load(memory_order_acquire);
+      atomic_thread_fence(memory_order_acquire);
+      if (parent_version->load(memory_order_relaxed) != seen_version || (version & 1)) {
+        restart = true;
+        break;
+      }
+      long left_size = node_size(node->child[0].load(memory_order_acquire));
+      parent_version = &node->version;
+      seen_version = version;
+      if (remaining == left_size) {
+        selected = node;
+        break;
+      }
+      if (remaining < left_size) {
+        node = node->child[0].load(memory_order_acquire);
+      } else {
+        remaining -= left_size + 1;
+        node = node->child[1].load(memory_order_acquire);
+      }
+    }
+    if (restart) {
+      restart_wait(backoff);
+      continue;
+    }
+
+    atomic_thread_fence(memory_order_acquire);
+    if (parent_version->load(memory_order_relaxed) == seen_version &&
+        relocations_unchanged(tree, relocations)) {
+      if (selected) key = selected->key;
+      epoch_exit();
+      return selected != nullptr;
+    }
+    restart_wait(backoff);
+  }
+}
+
+// Returns how many keys in the tree are in [lo, hi]
+template <typename Key, typename Value, typename Compare>
+size_t tree_count_range(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> lo, Arg<Key> hi) {
+  if (tree->compare(hi, lo)) return 0;
+  size_t below_hi = rank_of(tree, hi, true), below_lo = rank_of(tree, lo, false);
+  return below_hi > below_lo ? below_hi - below_lo : 0;
+}
+
+/******************************************************************************/
+/*                              ORDERED ITERATION                             */
+/******************************************************************************/
+/*   Range scans and iterators walk the tree in key order the way lookups      */
+/*   search it: optimistically, checking node versions instead of taking      */
+/*   flags. A scan keeps the path it took from the root and steps from node to  */
+/*   node along it, so k keys cost O(log n + k). If any node it relies on has   */
+/*   changed by the time it gets back to it, it searches again from the root   */
+/*   for the key after the last one it reported. Keys come out in order and at  */
+/*   most once; every key in the tree for the whole scan is reported, a key     */
+/*   inserted or deleted meanwhile may or may not be.                           */
+/******************************************************************************/
+
+// A node on the path a scan took from the root, with the version it had then.
+// Pending if the scan went past it towards child[1-dir] and has yet to visit it
+template <typename Key, typename Value>
+struct ScanEntry {
+  RedBlackNode<Key, Value> *node;
+  unsigned int version;
+  bool pending;
+};
+
+// Descends from the root to where key is (or would be) in the tree, leaving the
+// nodes it passed on path: the last pending one is then the first node after
+// key in direction dir (1 for ascending order), or key's own node if inclusive.
+// A null key stands for past the end, so the scan starts at the other end.
+// Returns false if the tree changed underneath.
+template <typename Key, typename Value, typename Compare>
+bool scan_seek(RedBlackTree<Key, Value, Compare> *&tree, vector<ScanEntry<Key, Value>> &path,
+               const Key *key, bool inclusive, int dir) {
+  typedef RedBlackNode<Key, Value> *Node;
+  path.clear();
+  // The head plays the part of the first parent
+  atomic<unsigned int> *parent_version = &tree->head.version;
+  unsigned int seen_version = parent_version->load(memory_order_acquire);
+  if (seen_version & 1) return false;
+  Node node = tree->head.child[0].load(memory_order_acquire);
+
+  while (node) {
+    unsigned int version = node->version.load(memory_order_acquire);
+    atomic_thread_fence(memory_order_acquire);
+    if (parent_version->load(memory_order_relaxed) != seen_version || (version & 1)) return false;
+    int next = 1 - dir;
+    if (key) {
+      bool equal;
+      next = key_direction(tree, *key, node->key, equal);
+      if (equal) {
+        if (inclusive) {
+          path.push_back({node, version, true});
+          return true;
+        }
+        next = dir;
+      }
+    }
+    path.push_back({node, version, next != dir});
+    parent_version = &node->version;
+    seen_version = version;
+    node = node->child[next].load(memory_order_acquire);
+  }
+  atomic_thread_fence(memory_order_acquire);
+  return parent_version->load(memory_order_relaxed) == seen_version;
+}
+
+// Drops the nodes at the end of path the scan is done with, leaving the next one
+// to visit last (or path empty past the end of the tree). Returns false if one
+// of them changed since the scan passed it.
+template <typename Key, typename Value>
+bool scan_settle(vector<ScanEntry<Key, Value>> &path) {
+  atomic_thread_fence(memory_order_acquire);
+  while (!path.empty()) {
+    ScanEntry<Key, Value> entry = path.back();
+    if (entry.node->version.load(memory_order_relaxed) != entry.version) return false;
+    if (entry.pending) return true;
+    path.pop_back();
+  }
+  return true;
+}
+
+// Moves on from the node last on path to the next one in direction dir: the
+// first in its child[dir] subtree if it has one, else the nearest pending node above
+template <typename Key, typename Value>
+bool scan_step(vector<ScanEntry<Key, Value>> &path, int dir) {
+  typedef RedBlackNode<Key, Value> *Node;
+  path.back().pending = false;
+  atomic<unsigned int> *parent_version = &path.back().node->version;
+  unsigned int seen_version = path.back().version;
+  Node node = path.back().node->child[dir].load(memory_order_acquire);
+
+  while (node) {
+    unsigned int version = node->version.load(memory_order_acquire);
+    atomic_thread_fence(memory_order_acquire);
+    if (parent_version->load(memory_order_relaxed) != seen_version || (version & 1)) return false;
+    path.push_back({node, version, true});
+    parent_version = &node->version;
+    seen_version = version;
+    node = node->child[1-dir].load(memory_order_acquire);
+  }
+  return scan_settle(path);
+}
+
+// Calls callback(key, value) for every key in [lo, hi] in ascending order,
+// returns how many keys it was called for. callback runs while no flags are
+// held, but should be quick: nodes deleted meanwhile can't be freed until it returns.
+template <typename Key, typename Value, typename Compare, typename Callback>
+size_t tree_range(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> lo, Arg<Key> hi, Callback callback) {
+  typedef RedBlackNode<Key, Value> *Node;
+  vector<ScanEntry<Key, Value>> path;
+  // Where a scan that has to search again carries on from
+  Key cursor = lo;
+  bool inclusive = true;
+  size_t visited = 0;
+  bool done = false;
+  Backoff_t backoff = {0};
+
+  epoch_enter();
+  while (!done) {
+    // Wait out a delete that is moving a node up past where we might be scanning
+    unsigned int relocations;
+    if (!relocation_snapshot(tree, relocations)) {
+      restart_wait(backoff);
+      continue;
+    }
+
+    bool valid = scan_seek(tree, path, &cursor, inclusive, 1) && scan_settle(path);
+    while (valid) {
+      if (path.empty() || tree->compare(hi, path.back().node->key)) {
+        done = true;
+        break;
+      }
+      Node node = path.back().node;
+      Value value;
+      if (!copy_value(node, value)) {
+        // Deleted, so carry on after it
+        cursor = node->key;
+        inclusive = false;
+        break;
+      }
+      if (!relocations_unchanged(tree, relocations)) {
+        restart_wait(backoff);
+        break;
+      }
+      callback(node->key, value);
+      visited++;
+      cursor = node->key;
+      inclusive = false;
+      valid = scan_step(path, 1);
+    }
+    // The tree changed underneath, give the writer a moment before searching again
+    if (!valid) restart_wait(backoff);
+  }
+  epoch_exit();
+  return visited;
+}
+
+// Points it at the first key after key in direction dir (or at key itself if
+// inclusive), from the end of the tree if key is null
+template <typename Key, typename Value, typename Compare>
+bool seek_iterator(RedBlackTree<Key, Value, Compare> *&tree, const Key *key, bool inclusive, int dir,
+                   TreeIterator<Key, Value> &it) {
+  vector<ScanEntry<Key, Value>> path;
+  Backoff_t backoff = {0};
+  epoch_enter();
+  while (true) {
+    unsigned int relocations;
+    if (!relocation_snapshot(tree, relocations)) {
+      restart_wait(backoff);
+      continue;
+    }
+    if (!scan_seek(tree, path, key, inclusive, dir) || !scan_settle(path)) {
+      restart_wait(backoff);
+      continue;
+    }
+    if (path.empty()) {
+      it.valid = false;
+      break;
+    }
+    RedBlackNode<Key, Value> *node = path.back().node;
+    // A deleted node is gone from the tree by now, look again
+    if (!copy_value(node, it.value)) continue;
+    if (!relocations_unchanged(tree, relocations)) {
+      restart_wait(backoff);
+      continue;
+    }
+    it.key = node->key;
+    it.valid = true;
+    break;
+  }
+  epoch_exit();
+  return it.valid;
+}
+
+// Iterator at the first key not less than key
+template <typename Key, typename Value, typename Compare>
+TreeIterator<Key, Value> tree_lower_bound(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key) {
+  TreeIterator<Key, Value> it;
+  Key from = key;
+  seek_iterator(tree, &from, true, 1, it);
+  return it;
+}
+
+// Iterator at the first key greater than key
+template <typename Key, typename Value, typename Compare>
+TreeIterator<Key, Value> tree_upper_bound(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key) {
+  TreeIterator<Key, Value> it;
+  Key from = key;
+  seek_iterator(tree, &from, false, 1, it);
+  return it;
+}
+
+// Moves it to the next key in the tree, or to the first key if it was past the end.
+// Returns whether it still points at a key.
+template <typename Key, typename Value, typename Compare>
+bool tree_successor(RedBlackTree<Key, Value, Compare> *&tree, TreeIterator<Key, Value> &it) {
+  if (!it.valid) return seek_iterator(tree, (const Key *)nullptr, false, 1, it);
+  Key from = it.key;
+  return seek_iterator(tree, &from, false, 1, it);
+}
+
+// Moves it to the previous key in the tree, or to the last key if it was past the end.
+// Returns whether it still points at a key.
+template <typename Key, typename Value, typename Compare>
+bool tree_predecessor(RedBlackTree<Key, Value, Compare> *&tree, TreeIterator<Key, Value> &it) {
+  if (!it.valid) return seek_iterator(tree, (const Key *)nullptr, false, 0, it);
+  Key from = it.key;
+  return seek_iterator(tree, &from, false, 0, it);
+}
+
+// Runs parallel lookup on values, returns how many of them were found
+template <typename Key, typename Value, typename Compare>
+int tree_lookup_bulk(RedBlackTree<Key, Value, Compare> *&tree, KeySpan<Key> values, int batch_size, int num_threads) {
+  int num_operations = values.size();
+  int found = 0;
+
+  int threads_needed = max(1, min(num_operations, num_threads));
+  #pragma omp parallel for schedule(dynamic, batch_size) num_threads(threads_needed) reduction(+:found)
+  for (int i = 0; i < num_operations; i++) {
+    found += tree_lookup(tree, values[i]);
+  }
+  return found;
+}
+
+// Inserts key (with value) into Tree, returns true if key wasn't already present
+// in the tree (an existing key keeps its value)
+// Rebalancing is done top-down in a single pass (color flips on the way down,
+// rotations at the grandparent), so the local area never has to move back up
+// Source: https://eternallyconfuzzled.com/red-black-trees-c-the-most-common-balanced-binary-search-tree
+template <typename Key, typename Value, typename Compare>
+bool tree_insert(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Arg<Value> value) {
+  typedef RedBlackNode<Key, Value> *Node;
+  // Reused across calls so inserting doesn't allocate anything but the new node
+  static thread_local vector<Node> flagged_nodes, path;
+
+  epoch_enter();
+  TREE_STAT(inserts, 1);
+  // With order statistics, a key already in the tree has to be turned away
+  // before anything is counted
+  if (tree->order_statistics) {
+    lock_key(tree, key);
+    if (lookup_node(tree, key)) {
+      unlock_key(tree, key);
+      epoch_exit();
+      return false;
+    }
+  }
+
+  // First, get tree root access
+  Node head = &tree->head;
+  add_to_local_area(head, flagged_nodes);
+  Node root = head->child[0];
+  // Edge Case: Set root of Empty tree
+  if (!root) {
+    begin_modify(head);
+    head->child[0] = newTreeNode(tree, key, value, false, head, nullptr, nullptr);
+    end_modify(head);
+    clear_local_area(flagged_nodes);
+    if (tree->order_statistics) unlock_key(tree, key);
+    epoch_exit();
+    return true;
+  }
+
+  // Search path from the head down to the current node, the last four entries
+  // of which are always in the local area. Every node on it but the head has
+  // already counted the new key.
+  path.assign({head, root});
+  add_to_local_area(root, flagged_nodes);
+  add_to_size(tree, root, 1);
+  bool inserted = false;
+  int fixups = 0;
+
+  while (true) {
+    Node node = path.back();
+    bool rebalanced = false;
+
+    // Flag the children so their colors can be read (and changed)
+    Node left = node->child[0], right = node->child[1];
+    if (left) add_to_local_area(left, flagged_nodes);
+    if (right) add_to_local_area(right, flagged_nodes);
+
+    // Node has two red children, swap colors with them
+    if (is_red(left) && is_red(right)) {
+      node->red = true;
+      left->red = false;
+      right->red = false;
+      // Root always stays black
+      if (path.size() == 2) {
+        node->red = false;
+      }
+      TREE_STAT(recolorings, 1);
+      rebalanced = true;
+    }
+
+    // Node and parent both red, rotate at the grandparent
+    // (a red parent is never the root, so the grandparent exists)
+    size_t depth = path.size();
+    if (depth >= 4 && node->red && path[depth - 2]->red) {
+      Node parent = path[depth - 2];
+      Node grandparent = path[depth - 3];
+      int dir = parent == grandparent->child[1];
+      if (node == parent->child[dir]) {
+        // Node is an outer child, a single rotation lifts parent above grandparent
+        rotateDir(tree, grandparent, 1-dir);
+        parent->red = false;
+        grandparent->red = true;
+        path.erase(path.end() - 3);
+      } else {
+        // Node is an inner child, a double rotation lifts node above both
+        rotateDir(tree, parent, dir);
+        rotateDir(tree, grandparent, 1-dir);
+        node->red = false;
+        grandparent->red = true;
+        path.erase(path.end() - 3, path.end() - 1);
+      }
+      rebalanced = true;
+    }
+    fixups += rebalanced;
+
+    // Either the key was already present or we just fixed up the new node
+    bool equal;
+    int dir = key_direction(tree, key, node->key, equal);
+    if (equal) {
+      break;
+    }
+
+    // Step down, creating the new node if we fell off the tree
+    Node next = node->child[dir];
+    if (!next) {
+      next = newTreeNode(tree, key, value, true, node, nullptr, nullptr);
+      begin_modify(node);
+      node->child[dir] = next;
+      end_modify(node);
+      inserted = true;
+      add_to_local_area(next, flagged_nodes);
+    } else {
+      add_to_size(tree, next, 1);
+    }
+    path.push_back(next);
+
+    // Slide the local area down to the last four nodes on the path
+    depth = path.size();
+    shrink_local_area(flagged_nodes, {path[depth - min(depth, (size_t)4)], path[depth - 3],
+                                      path[depth - 2], path[depth - 1]});
+  }
+
+  count_fixups(fixups);
+  clear_local_area(flagged_nodes);
+  if (tree->order_statistics) unlock_key(tree, key);
+  epoch_exit();
+  return inserted;
+}
+
+// Runs parallel insert on values
+template <typename Key, typename Value, typename Compare>
+void tree_insert_bulk(RedBlackTree<Key, Value, Compare> *&tree, KeySpan<Key> values, int batch_size, int num_threads) {
+  int num_operations = values.size();
+
+  int threads_needed = max(1, min(num_operations, num_threads));
+  #pragma omp parallel for schedule(dynamic, batch_size) num_threads(threads_needed)
+  for (int i = 0; i < num_operations; i++) {
+    tree_insert(tree, values[i]);
+  }
+  return;
+}
+
+// Sorted ranges with fewer keys than this are built by the task that found them
+#define BUILD_TASK_SIZE 4096
+
+// Builds a perfectly balanced subtree from keys[lo, hi) (and the matching values,
+// if any) whose root is at the given depth below parent. Only the nodes on the
+// deepest level of the whole tree (red_depth) are red, so every path from the
+// root has the same number of black nodes.
+template <typename Key, typename Value, typename Compare>
+RedBlackNode<Key, Value> *build_subtree(RedBlackTree<Key, Value, Compare> *&tree, const vector<Key> &keys,
+                                        const vector<Value> &values, size_t lo, size_t hi, int depth,
+                                        int red_depth, RedBlackNode<Key, Value> *parent) {
+  if (lo >= hi) return nullptr;
+  size_t mid = lo + (hi - lo) / 2;
+  RedBlackNode<Key, Value> *node = newTreeNode(tree, keys[mid], values.empty() ? Value() : values[mid],
+                                               depth == red_depth && depth > 0, parent, nullptr, nullptr);
+  node->size.store(hi - lo, memory_order_relaxed);
+  RedBlackNode<Key, Value> *left, *right;
+  if (hi - lo >= BUILD_TASK_SIZE) {
+    #pragma omp task shared(tree, keys, values, left)
+    left = build_subtree(tree, keys, values, lo, mid, depth + 1, red_depth, node);
+    right = build_subtree(tree, keys, values, mid + 1, hi, depth + 1, red_depth, node);
+    #pragma omp taskwait
+  } else {
+    left = build_subtree(tree, keys, values, lo, mid, depth + 1, red_depth, node);
+    right = build_subtree(tree, keys, values, mid + 1, hi, depth + 1, red_depth, node);
+  }
+  node->child[0].store(left, memory_order_relaxed);
+  node->child[1].store(right, memory_order_relaxed);
+  return node;
+}
+
+// Depth of the deepest level of a tree built from n sorted keys, splitting at the
+// middle leaves every leaf on that level or the one above
+inline int sorted_red_depth(size_t n) {
+  int red_depth = 0;
+  while (((size_t)2 << red_depth) <= n) red_depth++;
+  return red_depth;
+}
+
+// Fills an empty tree with keys, which must be sorted and unique under the tree's
+// Compare, in O(n) instead of n inserts: subtrees are built directly (in parallel
+// with num_threads threads) from halves of the array and the root is published
+// last. values, if given, holds the value for each key. Returns false, leaving
+// the tree empty, if the tree wasn't empty or keys aren't strictly increasing.
+// No other thread may be using the tree until this returns.
+template <typename Key, typename Value, typename Compare>
+bool tree_build_from_sorted(RedBlackTree<Key, Value, Compare> *&tree, const vector<Key> &keys,
+                            const vector<Value> &values, int num_threads) {
+  size_t n = keys.size();
+  RedBlackNode<Key, Value> *head = &tree->head;
+  if (head->child[0] || (!values.empty() && values.size() != n)) return false;
+
+  bool sorted = true;
+  #pragma omp parallel for num_threads(num_threads) reduction(&&:sorted)
+  for (size_t i = 1; i < n; i++) {
+    sorted = sorted && tree->compare(keys[i - 1], keys[i]);
+  }
+  if (!sorted) return false;
+
+  RedBlackNode<Key, Value> *root;
+  #pragma omp parallel num_threads(num_threads)
+  #pragma omp single
+  root = build_subtree(tree, keys, values, 0, n, 0, sorted_red_depth(n), head);
+
+  begin_modify(head);
+  head->child[0].store(root, memory_order_release);
+  end_modify(head);
+  return true;
+}
+
+// In-order keys and values of the subtree rooted at node
+template <typename Key, typename Value>
+void collect_subtree(RedBlackNode<Key, Value> *node, vector<Key> &keys, vector<Value> &values) {
+  if (!node) return;
+  collect_subtree(node->child[0].load(memory_order_relaxed), keys, values);
+  keys.push_back(node->key);
+  if (!is_empty<Value>::value) values.push_back(node->value);
+  collect_subtree(node->child[1].load(memory_order_relaxed), keys, values);
+}
+
+// Returns a read-only copy of the tree laid out for fast lookups (see
+// frozen-tree.h), which later changes to the tree don't affect. No other thread
+// may be changing the tree until this returns.
+template <typename Key, typename Value, typename Compare>
+FrozenTree<Key, Value, Compare> *tree_freeze(RedBlackTree<Key, Value, Compare> *&tree) {
+  vector<Key> keys;
+  vector<Value> values;
+  collect_subtree(tree->head.child[0].load(memory_order_acquire), keys, values);
+  return frozen_build(std::move(keys), std::move(values), tree->compare);
+}
+
+// Deletes key from the Tree, returns true if key was present in the tree
+// Like insert this runs top-down in a single pass: on the way down a red node is
+// pushed in front of the search (color flips with the sibling, or rotations at
+// the parent), so the node finally unlinked at the bottom is always red or the
+// root and no fixup has to walk back up
+// Source: https://eternallyconfuzzled.com/red-black-trees-c-the-most-common-balanced-binary-search-tree
+template <typename Key, typename Value, typename Compare>
+bool tree_delete(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key) {
+  typedef RedBlackNode<Key, Value> *Node;
+  static thread_local vector<Node> flagged_nodes;
+
+  epoch_enter();
+  TREE_STAT(deletes, 1);
+  // With order statistics, a key that isn't in the tree has to be turned away
+  // before anything is counted
+  if (tree->order_statistics) {
+    lock_key(tree, key);
+    if (!lookup_node(tree, key)) {
+      unlock_key(tree, key);
+      epoch_exit();
+      return false;
+    }
+  }
+
+  // First, get tree root access
+  Node head = &tree->head;
+  add_to_local_area(head, flagged_nodes);
+  // Don't delete from an empty tree
+  if (!head->child[0]) {
+    clear_local_area(flagged_nodes);
+    if (tree->order_statistics) unlock_key(tree, key);
+    epoch_exit();
+    return false;
+  }
+
+  // The head stands in for the parent of the root (which has no grandparent)
+  Node grandparent = nullptr, parent = head, node = head->child[0];
+  // Node holding key, which stays flagged (along with its parent) until it is
+  // replaced by its predecessor
+  Node found = nullptr;
+  int last = 1;
+  int fixups = 0;
+  add_to_local_area(node, flagged_nodes);
+  // Every node on the way down to the node finally unlinked no longer counts it
+  add_to_size(tree, node, -1);
+
+  while (true) {
+    // Flag the children so their colors can be read (and changed)
+    if (node->child[0]) add_to_local_area(node->child[0].load(), flagged_nodes);
+    if (node->child[1]) add_to_local_area(node->child[1].load(), flagged_nodes);
+
+    // Once key is found, keep going left then right to its in-order predecessor
+    bool equal;
+    int dir = key_direction(tree, key, node->key, equal);
+    if (equal) {
+      found = node;
+    }
+
+    // Push the red node down
+    if (!is_red(node) && !is_red(node->child[dir].load())) {
+      if (is_red(node->child[1-dir].load())) {
+        // Red child on the far side, rotate it above node
+        Node red_child = node->child[1-dir];
+        rotateDir(tree, node, dir);
+        node->red = true;
+        red_child->red = false;
+        parent = red_child;
+        fixups++;
+      } else if (parent != head) {
+        Node sibling = parent->child[1-last];
+        if (sibling) {
+          add_to_local_area(sibling, flagged_nodes);
+          Node close_nephew = sibling->child[last];
+          Node distant_nephew = sibling->child[1-last];
+          if (close_nephew) add_to_local_area(close_nephew, flagged_nodes);
+          if (distant_nephew) add_to_local_area(distant_nephew, flagged_nodes);
+
+          if (!is_red(close_nephew) && !is_red(distant_nephew)) {
+            // Both nephews black, swap colors with parent
+            parent->red = false;
+            sibling->red = true;
+            node->red = true;
+            TREE_STAT(recolorings, 1);
+          } else {
+            // A red nephew, rotate it (or the sibling) above parent
+            Node top;
+            if (is_red(close_nephew)) {
+              rotateDir(tree, sibling, 1-last);
+              top = rotateDir(tree, parent, last);
+            } else {
+              top = rotateDir(tree, parent, last);
+            }
+            node->red = true;
+            top->red = true;
+            top->child[0].load()->red = false;
+            top->child[1].load()->red = false;
+            // Root always stays black
+            if (grandparent == head) {
+              top->red = false;
+            }
+          }
+          fixups++;
+        }
+      }
+    }
+
+    Node next = node->child[dir];
+    if (!next) {
+      break;
+    }
+
+    // Step down and slide the local area along with us
+    grandparent = parent;
+    parent = node;
+    node = next;
+    last = dir;
+    add_to_size(tree, node, -1);
+    if (found) {
+      shrink_local_area(flagged_nodes, {grandparent, parent, node, found, found->parent});
+    } else {
+      shrink_local_area(flagged_nodes, {grandparent, parent, node});
+    }
+  }
+
+  if (found) {
+    // Keys never change once in the tree, so a node with two children is
+    // replaced by moving its predecessor node into its place. Lookups that
+    // already went past that place must be told to check again.
+    if (found != node) {
+      tree->relocating.fetch_add(1, memory_order_acq_rel);
+    }
+
+    // Unlink the predecessor (now red, or the root) which has at most one child
+    Node child = node->child[node->child[0] == nullptr];
+    begin_modify(parent);
+    parent->child[parent->child[1] == node] = child;
+    end_modify(parent);
+    if (child) {
+      child->parent = parent;
+      if (parent == head) child->red = false;
+    }
+
+    // Then move it up into the place of the node to be deleted
+    if (found != node) {
+      Node above = found->parent;
+      begin_modify(node);
+      for (int i = 0; i < 2; i++) {
+        node->child[i] = found->child[i].load();
+        if (node->child[i]) node->child[i].load()->parent = node;
+      }
+      node->red = found->red;
+      node->size.store(node_size(found), memory_order_relaxed);
+      node->parent = above;
+      end_modify(node);
+
+      begin_modify(above);
+      above->child[above->child[1] == found] = node;
+      end_modify(above);
+      tree->relocations.fetch_add(1, memory_order_release);
+      tree->relocating.fetch_sub(1, memory_order_release);
+    }
+    // Still under its flag, so tree_update and tree_find see it's gone, and
+    // versioned so copy_value does too
+    begin_modify(found);
+    found->removed = true;
+    end_modify(found);
+  }
+
+  // The removed node is no longer reachable (anyone still waiting on its flag
+  // finds it removed), but it is only freed once every thread that might still
+  // hold a pointer to it has left its critical section
+  count_fixups(fixups);
+  clear_local_area(flagged_nodes);
+  if (found) {
+    epoch_retire(found, free_tree_node<Key, Value>, tree->pool);
+  }
+  if (tree->order_statistics) unlock_key(tree, key);
+  epoch_exit();
+  return found != nullptr;
+}
+
+// Runs parallel delete on values
+template <typename Key, typename Value, typename Compare>
+void tree_delete_bulk(RedBlackTree<Key, Value, Compare> *&tree, KeySpan<Key> values, int batch_size, int num_threads) {
+  int num_operations = values.size();
+
+  int threads_needed = max(1, min(num_operations, num_threads));
+  #pragma omp parallel num_threads(threads_needed)
+  {
+    #pragma omp for schedule(dynamic, batch_size) nowait
+    for (int i = 0; i < num_operations; i++) {
+      tree_delete(tree, values[i]);
+    }
+    // Free this thread's removed nodes rather than holding them until its next delete
+    epoch_flush();
+  }
+  return;
+}
@@ -1,166 +1,648 @@
-#include <iostream>
-#include <fstream>
-#include <string>
-#include <unistd.h>
-#include "red-black-lock-free.h"
-#include <omp.h>
-#include <vector>
-#include <set>
-#include <sstream>
-#include <unordered_map>
-#include <chrono>
-#include <iomanip>
-
-using namespace std;
-
-int main(int argc, char *argv[]) {
-  // Command Line Input Code (adapted from Lab 3)
-  string input_filename;
-  int opt;
-  int num_operations, val;
-  int num_threads = 1;
-  int batch_size = 8;
-  bool correctness = false; // Option to enable correctness checker
-  vector<Operation_t> operations;
-
-  while ((opt = getopt(argc, argv, "f:b:n:c")) != -1) {
-    switch (opt) {
-      case 'f':
-        input_filename = optarg;
-        break;
-      case 'b':
-        batch_size = atoi(optarg);
-        break;
-      case 'n':
-        num_threads = atoi(optarg);
-        break;
-      case 'c':
-        correctness = true;
-        break;
-      default:
-        fprintf(stderr, "Usage: %s [-f input_filename] [-n num_threads] [-b batch_size]\n", argv[0]);
-        fprintf(stderr, "Options: -c (enable correctness checker)\n");
-        exit(EXIT_FAILURE);
-    }
-  }
-
-  if (empty(input_filename) || batch_size <= 0 || num_threads < 1) {
-    fprintf(stderr, "Usage: %s -f input_filename -n num_threads -b batch_size\n", argv[0]);
-    exit(EXIT_FAILURE);
-  }
-
-  // Attempt to open and read file
-  cout << "Input file: " << input_filename << '\n';
-  ifstream fin(input_filename);
-
-  if (!fin) {
-    cerr << "Unable to open file: " << input_filename << ".\n";
-    exit(EXIT_FAILURE);
-  }
-
-  unordered_map<string, int> operation_map = {
-    {"INSERT", 0},
-    {"DELETE", 1},
-    {"LOOKUP", 2}
-  };
-
-  string line;
-  // Keep reading until the end of the file
-  while (getline(fin, line)) {
-    stringstream ss(line);
-    string operation;
-    ss >> operation;
-    int operation_type;
-
-    if (operation_map.find(operation) != operation_map.end()) {
-      operation_type = operation_map[operation];
-    } else {
-      operation_type = EMPTY;
-    }
-
-    switch (operation_type) {
-      case INSERT:
-        ss >> num_operations;
-        operations.push_back({{}, INSERT});
-        break;
-      case DELETE:
-        ss >> num_operations;
-        operations.push_back({{}, DELETE});
-        break;
-      case LOOKUP:
-        ss >> num_operations;
-        operations.push_back({{}, LOOKUP});
-        break;
-      default:
-        vector<int> values = vector<int>(num_operations);
-        val = stoi(operation);
-        for (int i = 0; i < num_operations; i++) {
-          values[i] = val;
-          ss >> val;
-        }
-        operations.back().values = values;
-    }
-  }
-
-  // Testing!
-  // const auto compute_start = 0, compute_end = 0;
-  double compute_time = 0;
-
-  const auto compute_start = chrono::steady_clock::now();
-  Tree tree = tree_init();
-  const auto compute_end = chrono::steady_clock::now();
-  compute_time += chrono::duration_cast<chrono::duration<double>>(compute_end - compute_start).count();
-  set<int> correct_values;
-  for (Operation_t operation : operations) {
-    if (operation.type == INSERT) {
-      const auto compute_start = chrono::steady_clock::now();
-      tree_insert_bulk(tree, operation.values, batch_size, num_threads);
-      const auto compute_end = chrono::steady_clock::now();
-      compute_time += chrono::duration_cast<chrono::duration<double>>(compute_end - compute_start).count();
-      if (correctness) {
-        for (auto value : operation.values) {
-          correct_values.insert(value);
-        }
-      }
-    } else if (operation.type == DELETE) {
-      const auto compute_start = chrono::steady_clock::now();
-      tree_delete_bulk(tree, operation.values, batch_size, num_threads);
-      const auto compute_end = chrono::steady_clock::now();
-      compute_time += chrono::duration_cast<chrono::duration<double>>(compute_end - compute_start).count();
-      if (correctness) {
-        for (auto value : operation.values) {
-          correct_values.erase(value);
-        }
-      }
-    }
-
-    if (correctness) {
-      if (!tree_validate(tree)) {
-        printf("Testing failed.\n");
-        exit(1);
-      }
-      // Ensure tree has correct elems
-      vector<int> tree_values = tree_to_vector(tree);
-      if (tree_values.size() != correct_values.size()) {
-        printf("Tree has incorrect size.\n");
-        printf("Expecting %ld elements. Found %ld elements.\n", correct_values.size(), tree_values.size());
-        printf("Testing failed\n");
-        // print_tree(tree->root);
-        exit(1);
-      }
-      for (size_t i = 0; i < tree_values.size(); i++) {
-        if (correct_values.find(tree_values[i]) == correct_values.end()) {
-          printf("Tree contains value not present in correct code\n");
-          printf("Testing failed\n");
-          exit(1);
-        }
-      }
-      
-    }
-  }
-  
-  cout << "Computation time (sec): " << fixed << setprecision(10) << compute_time << '\n';
-
-  printf("Success.\n");
-  return 0;
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include "red-black-lock-free.h"
+#include "workload.h"
+#include "sharded-tree.h"
+#include <omp.h>
+#include <vector>
+#include <set>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <climits>
+#include <random>
+
+using namespace std;
+
+// Prints the instrumentation counters gathered while building the tree
+static void print_tree_stats(TreeStats_t stats) {
+#ifndef TREE_STATS
+  cout << "Instrumentation is compiled out, rebuild with make parallel STATS=1\n";
+  return;
+#endif
+  uint64_t operations = max<uint64_t>(1, stats.inserts + stats.deletes);
+  cout << "Inserts: " << stats.inserts << ", deletes: " << stats.deletes << '\n';
+  cout << "Restarts: " << stats.restarts << ", CAS failures: " << stats.cas_failures
+       << ", spin iterations: " << stats.spin_iterations << '\n';
+  cout << "Rotations: " << stats.rotations << ", recolorings: " << stats.recolorings << " ("
+       << fixed << setprecision(4) << (double)(stats.rotations + stats.recolorings) / operations
+       << " per insert/delete)\n";
+  cout << "Fixup depth:";
+  for (int i = 0; i < FIXUP_DEPTH_BUCKETS; i++) {
+    cout << ' ' << i << (i == FIXUP_DEPTH_BUCKETS - 1 ? "+:" : ":") << stats.fixup_depth[i];
+  }
+  cout << '\n';
+}
+
+int main(int argc, char *argv[]) {
+  // Command Line Input Code (adapted from Lab 3)
+  string input_filename;
+  int opt;
+  int num_threads = 1;
+  int batch_size = 8;
+  bool correctness = false; // Option to enable correctness checker
+  int num_lookups = 0; // Option to run the read throughput benchmark afterwards
+  int num_scans = 0; // Option to run the range scan benchmark afterwards
+  int num_updates = 0; // Option to run the update throughput benchmark afterwards
+  int num_relocations = 0; // Option to stress lookups against deletes that relocate nodes
+  bool use_node_pool = false; // Option to allocate nodes from a node pool
+  bool order_statistics = false; // Option to keep subtree sizes for tree_rank and tree_select
+  bool allocator_benchmark = false; // Option to compare allocators afterwards
+  bool memory_report = false; // Option to report the tree's memory usage
+  bool bulk_load_benchmark = false; // Option to compare bulk loading to inserts
+  bool batch_benchmark = false; // Option to compare join-based batches to bulk operations
+  int num_shards = 0; // Option to compare sharded bulk operations to a single tree's
+  bool contention_report = false; // Option to report how often threads had to wait
+  bool dump_stats = false; // Option to dump the instrumentation counters (TREE_STATS builds)
+  ContentionManager_t manager = contention_manager();
+  vector<Operation_t> operations;
+
+  while ((opt = getopt(argc, argv, "f:b:n:cr:s:u:x:k:h:paomljtd")) != -1) {
+    switch (opt) {
+      case 'f':
+        input_filename = optarg;
+        break;
+      case 'b':
+        batch_size = atoi(optarg);
+        break;
+      case 'n':
+        num_threads = atoi(optarg);
+        break;
+      case 'c':
+        correctness = true;
+        break;
+      case 'r':
+        num_lookups = atoi(optarg);
+        break;
+      case 's':
+        num_scans = atoi(optarg);
+        break;
+      case 'u':
+        num_updates = atoi(optarg);
+        break;
+      case 'x':
+        num_relocations = atoi(optarg);
+        break;
+      case 'p':
+        use_node_pool = true;
+        break;
+      case 'o':
+        order_statistics = true;
+        break;
+      case 'a':
+        allocator_benchmark = true;
+        break;
+      case 'm':
+        memory_report = true;
+        break;
+      case 'l':
+        bulk_load_benchmark = true;
+        break;
+      case 'j':
+        batch_benchmark = true;
+        break;
+      case 't':
+        contention_report = true;
+        break;
+      case 'd':
+        dump_stats = true;
+        break;
+      case 'h':
+        num_shards = atoi(optarg);
+        break;
+      case 'k':
+        if (sscanf(optarg, "%u,%u,%u", &manager.min_pause, &manager.max_pause, &manager.yield_after) != 3) {
+          fprintf(stderr, "Backoff must be given as min_pause,max_pause,yield_after\n");
+          exit(EXIT_FAILURE);
+        }
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [-f input_filename] [-n num_threads] [-b batch_size]\n", argv[0]);
+        fprintf(stderr, "Options: -c (enable correctness checker)\n");
+        fprintf(stderr, "         -r num_lookups (benchmark lookup throughput at 1-64 threads)\n");
+        fprintf(stderr, "         -s num_scans (benchmark range scan throughput at 1-64 threads)\n");
+        fprintf(stderr, "         -u num_updates (benchmark insert/delete throughput at 8-64 threads)\n");
+        fprintf(stderr, "         -x num_keys (check and time lookups against deletes that relocate nodes)\n");
+        fprintf(stderr, "         -p (allocate nodes from a node pool)\n");
+        fprintf(stderr, "         -o (keep order statistics, checked by -c)\n");
+        fprintf(stderr, "         -a (benchmark tree_insert_bulk with new/delete vs a node pool)\n");
+        fprintf(stderr, "         -m (report the tree's memory usage and teardown time)\n");
+        fprintf(stderr, "         -l (benchmark tree_build_from_sorted vs tree_insert_bulk)\n");
+        fprintf(stderr, "         -j (benchmark tree_insert/delete_batch vs tree_insert/delete_bulk)\n");
+        fprintf(stderr, "         -h num_shards (benchmark bulk operations on that many shards vs one tree)\n");
+        fprintf(stderr, "         -t (report retries per operation)\n");
+        fprintf(stderr, "         -d (dump instrumentation counters, built with make parallel STATS=1)\n");
+        fprintf(stderr, "         -k min_pause,max_pause,yield_after (tune how threads back off)\n");
+        exit(EXIT_FAILURE);
+    }
+  }
+
+  if (empty(input_filename) || batch_size <= 0 || num_threads < 1 || num_lookups < 0 || num_scans < 0 ||
+      num_updates < 0 || num_relocations < 0 || num_shards < 0) {
+    fprintf(stderr, "Usage: %s -f input_filename -n num_threads -b batch_size\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  // Attempt to open and read file (text or binary, see workload.h)
+  cout << "Input file: " << input_filename << '\n';
+  const auto load_start = chrono::steady_clock::now();
+  Workload_t workload = workload_open(input_filename);
+  if (!workload) {
+    exit(EXIT_FAILURE);
+  }
+  const auto load_end = chrono::steady_clock::now();
+  cout << "Load time (sec): " << fixed << setprecision(10)
+       << chrono::duration_cast<chrono::duration<double>>(load_end - load_start).count() << '\n';
+  for (size_t i = 0; i < workload->runs.size(); i++) {
+    operations.push_back({span<const int>(workload->keys + workload->offsets[i], workload->runs[i].count),
+                          (int)workload->runs[i].type});
+  }
+
+  // Testing!
+  // const auto compute_start = 0, compute_end = 0;
+  double compute_time = 0;
+  size_t num_updates_done = 0;
+  contention_configure(manager);
+  contention_reset_stats();
+  tree_stats_reset();
+
+  const auto compute_start = chrono::steady_clock::now();
+  Tree tree = tree_init(use_node_pool, order_statistics);
+  const auto compute_end = chrono::steady_clock::now();
+  compute_time += chrono::duration_cast<chrono::duration<double>>(compute_end - compute_start).count();
+  set<int> correct_values;
+  for (Operation_t operation : operations) {
+    if (operation.type == INSERT) {
+      const auto compute_start = chrono::steady_clock::now();
+      tree_insert_bulk(tree, operation.values, batch_size, num_threads);
+      const auto compute_end = chrono::steady_clock::now();
+      compute_time += chrono::duration_cast<chrono::duration<double>>(compute_end - compute_start).count();
+      num_updates_done += operation.values.size();
+      if (correctness) {
+        for (auto value : operation.values) {
+          correct_values.insert(value);
+        }
+      }
+    } else if (operation.type == DELETE) {
+      const auto compute_start = chrono::steady_clock::now();
+      tree_delete_bulk(tree, operation.values, batch_size, num_threads);
+      const auto compute_end = chrono::steady_clock::now();
+      compute_time += chrono::duration_cast<chrono::duration<double>>(compute_end - compute_start).count();
+      num_updates_done += operation.values.size();
+      if (correctness) {
+        for (auto value : operation.values) {
+          correct_values.erase(value);
+        }
+      }
+    } else if (operation.type == LOOKUP) {
+      const auto compute_start = chrono::steady_clock::now();
+      int found = tree_lookup_bulk(tree, operation.values, batch_size, num_threads);
+      const auto compute_end = chrono::steady_clock::now();
+      compute_time += chrono::duration_cast<chrono::duration<double>>(compute_end - compute_start).count();
+      if (correctness) {
+        int expected = count_if(operation.values.begin(), operation.values.end(),
+                                [&](int value) { return correct_values.count(value); });
+        if (found != expected) {
+          printf("Lookups found %d keys, expecting %d.\n", found, expected);
+          printf("Testing failed\n");
+          exit(1);
+        }
+      }
+    }
+
+    if (correctness) {
+      if (!tree_validate(tree)) {
+        printf("Testing failed.\n");
+        exit(1);
+      }
+      // Ensure tree has correct elems
+      vector<int> tree_values = tree_to_vector(tree);
+      if (tree_values.size() != correct_values.size()) {
+        printf("Tree has incorrect size.\n");
+        printf("Expecting %ld elements. Found %ld elements.\n", correct_values.size(), tree_values.size());
+        printf("Testing failed\n");
+        // print_tree(tree->head.child[0].load());
+        exit(1);
+      }
+      for (size_t i = 0; i < tree_values.size(); i++) {
+        if (correct_values.find(tree_values[i]) == correct_values.end()) {
+          printf("Tree contains value not present in correct code\n");
+          printf("Testing failed\n");
+          exit(1);
+        }
+      }
+      
+    }
+  }
+  
+  if (correctness) {
+    // Walking the tree both ways and scanning all of it visit the keys in order
+    vector<int> tree_values = tree_to_vector(tree);
+    vector<int> forward, backward, scanned;
+    TreeIterator<int> it = {};
+    while (tree_successor(tree, it)) forward.push_back(it.key);
+    while (tree_predecessor(tree, it)) backward.push_back(it.key);
+    reverse(backward.begin(), backward.end());
+    if (!tree_values.empty()) {
+      tree_range(tree, tree_values.front(), tree_values.back(), [&](int key, NoValue) { scanned.push_back(key); });
+    }
+    if (forward != tree_values || backward != tree_values || scanned != tree_values) {
+      printf("Iterated over the tree in the wrong order.\n");
+      printf("Testing failed\n");
+      exit(1);
+    }
+    // A frozen copy finds every key and nothing in between, and so do batches
+    auto frozen = tree_freeze(tree);
+    vector<int> probes;
+    for (int key : tree_values) {
+      if (!frozen_lookup(frozen, key) || frozen_lookup(frozen, key + 1) != tree_lookup(tree, key + 1)) {
+        printf("Frozen tree disagrees with the tree at %d.\n", key);
+        printf("Testing failed\n");
+        exit(1);
+      }
+      probes.insert(probes.end(), {key, key + 1});
+    }
+    frozen_free(frozen);
+    vector<bool> results;
+    tree_lookup_batch(tree, probes, results);
+    for (size_t i = 0; i < probes.size(); i++) {
+      if (results[i] != tree_lookup(tree, probes[i])) {
+        printf("Batch lookup disagrees with the tree at %d.\n", probes[i]);
+        printf("Testing failed\n");
+        exit(1);
+      }
+    }
+    // Every key's rank is its index in sorted order
+    for (size_t i = 0; order_statistics && i < tree_values.size(); i++) {
+      int selected;
+      if (tree_rank(tree, tree_values[i]) != i || !tree_select(tree, i, selected) || selected != tree_values[i] ||
+          tree_count_range(tree, tree_values[i], tree_values.back()) != tree_values.size() - i) {
+        printf("Tree has wrong order statistics.\n");
+        printf("Testing failed\n");
+        exit(1);
+      }
+    }
+  }
+
+  cout << "Computation time (sec): " << fixed << setprecision(10) << compute_time << '\n';
+
+  if (contention_report) {
+    ContentionStats_t stats = contention_stats();
+    double per_update = num_updates_done ? (double)stats.retries / num_updates_done : 0;
+    cout << "Retries per operation: " << fixed << setprecision(4) << per_update << " (" << stats.yields
+         << " of " << stats.retries << " yielded, at most " << stats.max_attempts << " attempts in one wait)\n";
+  }
+  if (dump_stats) {
+    print_tree_stats(tree_stats());
+  }
+
+  if (memory_report) {
+    TreeMemory_t memory = tree_memory(tree);
+    cout << "Nodes: " << memory.nodes << ", bytes: " << memory.bytes << ", bytes per key: "
+         << fixed << setprecision(2) << memory.bytes_per_key << '\n';
+  }
+
+  // Read throughput benchmark: lookups of keys from the input file against the
+  // tree it built, half of which are (usually) misses
+  if (num_lookups > 0) {
+    vector<int> keys;
+    for (Operation_t operation : operations) {
+      if (operation.type == INSERT) {
+        keys.insert(keys.end(), operation.values.begin(), operation.values.end());
+      }
+    }
+    if (keys.empty()) keys.push_back(0);
+    vector<int> lookups(num_lookups);
+    for (int i = 0; i < num_lookups; i++) {
+      lookups[i] = keys[rand() % keys.size()] + (i & 1);
+    }
+
+    double base_throughput = 0;
+    cout << "Threads  Lookups/sec     Speedup\n";
+    for (int threads = 1; threads <= 64; threads *= 2) {
+      const auto lookup_start = chrono::steady_clock::now();
+      tree_lookup_bulk(tree, lookups, batch_size, threads);
+      const auto lookup_end = chrono::steady_clock::now();
+      double lookup_time = chrono::duration_cast<chrono::duration<double>>(lookup_end - lookup_start).count();
+      double throughput = num_lookups / lookup_time;
+      if (threads == 1) base_throughput = throughput;
+      cout << setw(7) << threads << "  " << scientific << setprecision(4) << throughput
+           << "  " << fixed << setprecision(2) << setw(7) << throughput / base_throughput << '\n';
+    }
+
+    // Same lookups on one thread as one batch walked down the tree in lockstep
+    vector<bool> results;
+    const auto tree_batch_start = chrono::steady_clock::now();
+    size_t tree_batch_found = tree_lookup_batch(tree, lookups, results);
+    const auto tree_batch_end = chrono::steady_clock::now();
+    double tree_batch_time = chrono::duration_cast<chrono::duration<double>>(tree_batch_end - tree_batch_start).count();
+    cout << "Batched  " << scientific << setprecision(4) << num_lookups / tree_batch_time << "  " << fixed
+         << setprecision(2) << setw(7) << num_lookups / tree_batch_time / base_throughput << " ("
+         << tree_batch_found << " found)\n";
+
+    // And against a frozen copy of the tree
+    auto frozen = tree_freeze(tree);
+    size_t found = 0;
+    const auto frozen_start = chrono::steady_clock::now();
+    for (int key : lookups) {
+      found += frozen_lookup(frozen, key);
+    }
+    const auto frozen_end = chrono::steady_clock::now();
+    double frozen_time = chrono::duration_cast<chrono::duration<double>>(frozen_end - frozen_start).count();
+    cout << " Frozen  " << scientific << setprecision(4) << num_lookups / frozen_time << "  " << fixed
+         << setprecision(2) << setw(7) << num_lookups / frozen_time / base_throughput << " (" << found
+         << " found)\n";
+    const auto batch_start = chrono::steady_clock::now();
+    size_t batch_found = frozen_lookup_batch(frozen, lookups, results);
+    const auto batch_end = chrono::steady_clock::now();
+    double batch_time = chrono::duration_cast<chrono::duration<double>>(batch_end - batch_start).count();
+    cout << "  Batch  " << scientific << setprecision(4) << num_lookups / batch_time << "  " << fixed
+         << setprecision(2) << setw(7) << num_lookups / batch_time / base_throughput << " (" << batch_found
+         << " found)\n";
+    frozen_free(frozen);
+  }
+
+  // Range scan benchmark: scans starting at keys from the input file, each over
+  // about 64 keys' worth of the key space
+  if (num_scans > 0) {
+    vector<int> keys = tree_to_vector(tree);
+    if (keys.empty()) keys.push_back(0);
+    long span = max(1L, ((long)keys.back() - keys.front()) * 64 / (long)keys.size());
+    vector<int> starts(num_scans);
+    for (int i = 0; i < num_scans; i++) {
+      starts[i] = keys[rand() % keys.size()];
+    }
+
+    double base_throughput = 0;
+    cout << "Threads  Scans/sec       Keys/scan  Speedup\n";
+    for (int threads = 1; threads <= 64; threads *= 2) {
+      size_t visited = 0;
+      const auto scan_start = chrono::steady_clock::now();
+      #pragma omp parallel for schedule(dynamic, batch_size) num_threads(threads) reduction(+:visited)
+      for (int i = 0; i < num_scans; i++) {
+        int hi = (int)min((long)INT_MAX, starts[i] + span);
+        visited += tree_range(tree, starts[i], hi, [](int, NoValue) {});
+      }
+      const auto scan_end = chrono::steady_clock::now();
+      double scan_time = chrono::duration_cast<chrono::duration<double>>(scan_end - scan_start).count();
+      double throughput = num_scans / scan_time;
+      if (threads == 1) base_throughput = throughput;
+      cout << setw(7) << threads << "  " << scientific << setprecision(4) << throughput << "  " << fixed
+           << setprecision(1) << setw(9) << (double)visited / num_scans << "  " << setprecision(2) << setw(7)
+           << throughput / base_throughput << '\n';
+    }
+  }
+
+  // Update throughput benchmark: on a copy of the tree the input file built,
+  // each thread inserts random keys in its range and deletes them again, so
+  // writers keep meeting each other near the root while the tree size holds
+  if (num_updates > 0) {
+    vector<int> keys = tree_to_vector(tree);
+    if (keys.empty()) keys.push_back(0);
+    long span = max(1L, (long)keys.back() - keys.front() + 1);
+    vector<int> updates(num_updates / 2);
+    for (size_t i = 0; i < updates.size(); i++) {
+      updates[i] = (int)(keys.front() + rand() % span);
+    }
+
+    cout << "Threads  Updates/sec     Retries/update\n";
+    for (int threads = 8; threads <= 64; threads *= 2) {
+      Tree bench_tree = tree_init(use_node_pool, order_statistics);
+      tree_build_from_sorted(bench_tree, keys, {}, num_threads);
+      size_t done = 0;
+      contention_reset_stats();
+      const auto update_start = chrono::steady_clock::now();
+      #pragma omp parallel for schedule(dynamic, batch_size) num_threads(threads) reduction(+:done)
+      for (size_t i = 0; i < updates.size(); i++) {
+        done++;
+        if (tree_insert(bench_tree, updates[i])) {
+          tree_delete(bench_tree, updates[i]);
+          done++;
+        }
+      }
+      const auto update_end = chrono::steady_clock::now();
+      double update_time = chrono::duration_cast<chrono::duration<double>>(update_end - update_start).count();
+      cout << setw(7) << threads << "  " << scientific << setprecision(4) << done / update_time << "  " << fixed
+           << setw(14) << (double)contention_stats().retries / done << '\n';
+      if (!tree_validate(bench_tree)) {
+        printf("Tree is incorrect after the update benchmark.\n");
+        exit(1);
+      }
+      tree_free(bench_tree, num_threads);
+    }
+  }
+
+  // Relocation stress test: half the threads delete the even keys of a tree
+  // holding 0..2n-1 while the others keep looking up the odd keys. Deleting a
+  // node with two children moves its predecessor, an odd key, up into its place,
+  // and every odd key must still be found (and scanned) while that happens. Also
+  // times the lookups alone and alongside the deletes.
+  if (num_relocations > 0) {
+    int n = num_relocations;
+    vector<int> keys(2 * n), evens(n), odds(n);
+    for (int i = 0; i < 2 * n; i++) keys[i] = i;
+    for (int i = 0; i < n; i++) {
+      evens[i] = 2 * i;
+      odds[i] = 2 * i + 1;
+    }
+    shuffle(evens.begin(), evens.end(), mt19937(1));
+    shuffle(odds.begin(), odds.end(), mt19937(2));
+    int threads = max(2, num_threads), deleters = threads / 2, lookers = threads - deleters;
+
+    Tree stress_tree = tree_init(use_node_pool, order_statistics);
+    tree_build_from_sorted(stress_tree, keys, {}, num_threads);
+    const auto alone_start = chrono::steady_clock::now();
+    size_t found_alone = tree_lookup_bulk(stress_tree, odds, batch_size, lookers);
+    const auto alone_end = chrono::steady_clock::now();
+    double alone_time = chrono::duration_cast<chrono::duration<double>>(alone_end - alone_start).count();
+
+    atomic<int> deleting(deleters);
+    size_t looked = 0, missed = 0;
+    const auto stress_start = chrono::steady_clock::now();
+    #pragma omp parallel num_threads(threads) reduction(+:looked, missed)
+    {
+      int id = omp_get_thread_num();
+      if (id < deleters) {
+        for (int i = id; i < n; i += deleters) tree_delete(stress_tree, evens[i]);
+        deleting--;
+      } else {
+        // At least one pass over this thread's keys, then more until the deletes are done
+        do {
+          for (int i = id - deleters; i < n; i += lookers) {
+            missed += !tree_lookup(stress_tree, odds[i]);
+            looked++;
+            // Scans seek down the tree the same way
+            if (i % 8 == 0) missed += tree_range(stress_tree, odds[i], odds[i], [](int, NoValue) {}) != 1;
+          }
+        } while (deleting.load(memory_order_relaxed) > 0);
+      }
+    }
+    const auto stress_end = chrono::steady_clock::now();
+    double stress_time = chrono::duration_cast<chrono::duration<double>>(stress_end - stress_start).count();
+
+    cout << "Lookups/sec alone: " << scientific << setprecision(4) << n / alone_time << ", alongside deletes: "
+         << looked / stress_time << " (" << stress_tree->relocations.load() << " relocations)\n";
+    if (found_alone != (size_t)n || missed || !tree_validate(stress_tree) || tree_size(stress_tree) != n) {
+      printf("Lookups missed %zu keys while deletes relocated nodes.\n", missed);
+      printf("Testing failed\n");
+      exit(1);
+    }
+    tree_free(stress_tree, num_threads);
+  }
+
+  // Allocator benchmark: build a fresh tree from every inserted value in one
+  // tree_insert_bulk, once with new/delete and once with a node pool
+  if (allocator_benchmark) {
+    vector<int> values;
+    for (Operation_t operation : operations) {
+      if (operation.type == INSERT) {
+        values.insert(values.end(), operation.values.begin(), operation.values.end());
+      }
+    }
+    for (bool pooled : {false, true}) {
+      Tree bench_tree = tree_init(pooled);
+      const auto insert_start = chrono::steady_clock::now();
+      tree_insert_bulk(bench_tree, values, batch_size, num_threads);
+      const auto insert_end = chrono::steady_clock::now();
+      double insert_time = chrono::duration_cast<chrono::duration<double>>(insert_end - insert_start).count();
+      cout << "Insert time with " << (pooled ? "node pool (sec):  " : "new/delete (sec): ")
+           << fixed << setprecision(10) << insert_time << '\n';
+      tree_free(bench_tree, num_threads);
+    }
+  }
+
+  // Bulk load benchmark: build a fresh tree from every inserted value, sorted,
+  // once with tree_insert_bulk and once with tree_build_from_sorted
+  if (bulk_load_benchmark) {
+    set<int> unique_values;
+    for (Operation_t operation : operations) {
+      if (operation.type == INSERT) {
+        unique_values.insert(operation.values.begin(), operation.values.end());
+      }
+    }
+    vector<int> values(unique_values.begin(), unique_values.end());
+    for (bool from_sorted : {false, true}) {
+      Tree bench_tree = tree_init(use_node_pool);
+      const auto load_start = chrono::steady_clock::now();
+      if (from_sorted) {
+        tree_build_from_sorted(bench_tree, values, {}, num_threads);
+      } else {
+        tree_insert_bulk(bench_tree, values, batch_size, num_threads);
+      }
+      const auto load_end = chrono::steady_clock::now();
+      double load_time = chrono::duration_cast<chrono::duration<double>>(load_end - load_start).count();
+      cout << "Load time with " << (from_sorted ? "tree_build_from_sorted (sec): " : "tree_insert_bulk (sec):       ")
+           << fixed << setprecision(10) << load_time << '\n';
+      if (!tree_validate(bench_tree) || tree_to_vector(bench_tree) != values) {
+        printf("Bulk loaded tree is incorrect.\n");
+        exit(1);
+      }
+      tree_free(bench_tree, num_threads);
+    }
+  }
+
+  // Batch benchmark: replay the input's inserts and deletes on a fresh tree, once
+  // with tree_insert/delete_bulk and once with the join-based tree_insert/delete_batch
+  if (batch_benchmark) {
+    vector<int> bulk_result;
+    for (bool join_based : {false, true}) {
+      Tree bench_tree = tree_init(use_node_pool);
+      const auto replay_start = chrono::steady_clock::now();
+      for (Operation_t operation : operations) {
+        if (operation.type == INSERT) {
+          if (join_based) {
+            tree_insert_batch(bench_tree, vector<int>(operation.values.begin(), operation.values.end()), {},
+                              num_threads);
+          } else {
+            tree_insert_bulk(bench_tree, operation.values, batch_size, num_threads);
+          }
+        } else if (operation.type == DELETE) {
+          if (join_based) {
+            tree_delete_batch(bench_tree, vector<int>(operation.values.begin(), operation.values.end()),
+                              num_threads);
+          } else {
+            tree_delete_bulk(bench_tree, operation.values, batch_size, num_threads);
+          }
+        }
+      }
+      const auto replay_end = chrono::steady_clock::now();
+      double replay_time = chrono::duration_cast<chrono::duration<double>>(replay_end - replay_start).count();
+      cout << "Update time with " << (join_based ? "tree_insert/delete_batch (sec): " : "tree_insert/delete_bulk (sec):  ")
+           << fixed << setprecision(10) << replay_time << '\n';
+      if (!tree_validate(bench_tree)) {
+        printf("Batch updated tree is incorrect.\n");
+        exit(1);
+      }
+      if (!join_based) {
+        bulk_result = tree_to_vector(bench_tree);
+      } else if (tree_to_vector(bench_tree) != bulk_result) {
+        printf("Batch updated tree does not match the bulk updated tree.\n");
+        exit(1);
+      }
+      tree_free(bench_tree, num_threads);
+    }
+  }
+
+  // Shard benchmark: replay the input on one tree with tree_*_bulk, then on
+  // num_shards trees split at the inserted keys' quantiles with sharded_*_bulk
+  if (num_shards) {
+    vector<int> sample;
+    for (Operation_t operation : operations) {
+      if (operation.type == INSERT) sample.insert(sample.end(), operation.values.begin(), operation.values.end());
+    }
+    Tree single = tree_init(use_node_pool);
+    ShardedTree<Tree> *sharded = sharded_init<Tree>(sharded_splitters(sample, num_shards), false,
+                                                    [&] { return tree_init(use_node_pool); });
+    size_t single_found = 0, sharded_found = 0;
+    for (bool use_shards : {false, true}) {
+      const auto replay_start = chrono::steady_clock::now();
+      for (Operation_t operation : operations) {
+        if (operation.type == INSERT) {
+          if (use_shards) {
+            sharded_insert_bulk(sharded, operation.values, num_threads);
+          } else {
+            tree_insert_bulk(single, operation.values, batch_size, num_threads);
+          }
+        } else if (operation.type == DELETE) {
+          if (use_shards) {
+            sharded_delete_bulk(sharded, operation.values, num_threads);
+          } else {
+            tree_delete_bulk(single, operation.values, batch_size, num_threads);
+          }
+        } else if (operation.type == LOOKUP) {
+          if (use_shards) {
+            sharded_found += sharded_lookup_bulk(sharded, operation.values, num_threads);
+          } else {
+            single_found += tree_lookup_bulk(single, operation.values, batch_size, num_threads);
+          }
+        }
+      }
+      const auto replay_end = chrono::steady_clock::now();
+      double replay_time = chrono::duration_cast<chrono::duration<double>>(replay_end - replay_start).count();
+      cout << "Replay time with " << (use_shards ? to_string(num_shards) + " shards (sec): " : "one tree (sec):  ")
+           << fixed << setprecision(10) << replay_time << '\n';
+    }
+    // A scan over every shard visits the same keys in order as the single tree holds
+    vector<int> scanned;
+    sharded_range(sharded, INT_MIN, INT_MAX, [&](int key, NoValue) { scanned.push_back(key); });
+    if (!sharded_validate(sharded) || scanned != tree_to_vector(single) || sharded_found != single_found) {
+      printf("Sharded tree does not match the single tree.\n");
+      exit(1);
+    }
+    tree_free(single, num_threads);
+    sharded_free(sharded);
+  }
+
+  const auto free_start = chrono::steady_clock::now();
+  tree_free(tree, num_threads);
+  const auto free_end = chrono::steady_clock::now();
+  if (memory_report) {
+    cout << "Teardown time (sec): " << fixed << setprecision(10)
+         << chrono::duration_cast<chrono::duration<double>>(free_end - free_start).count() << '\n';
+  }
+
+  workload_close(workload);
+  printf("Success.\n");
+  return 0;
 }
\ No newline at end of file
@@ -1,73 +1,269 @@
-#include <atomic>
-#include <vector>
-#include <string>
-#include <omp.h>
-#include <stdlib.h>
-
-using namespace std;
-
-#define DEFAULT_MARKER -1
-
-enum OperationType {
-  INSERT,
-  DELETE,
-  LOOKUP,
-  EMPTY
-};
-
-typedef struct RedBlackNode {
-  struct RedBlackNode* child[2];
-  struct RedBlackNode* parent;
-  int val;
-  int marker;
-  atomic<bool> flag;
-  bool red;
-} *TreeNode;
-
-typedef struct RedBlackTree {
-  TreeNode root;
-  atomic<bool> root_flag;
-} *Tree;
-
-// Tree Functions
-Tree tree_init();
-bool tree_insert(Tree &tree, int val);
-bool tree_delete(Tree &tree, int val);
-bool tree_lookup(Tree &tree, int val);
-void tree_insert_bulk(Tree &tree, vector<int> values, int batch_size, int num_threads);
-void tree_delete_bulk(Tree &tree, vector<int> values, int batch_size, int num_threads);
-
-// (Sequential) Debug Functions
-int tree_size(Tree &tree);
-bool tree_validate(Tree &tree);
-string tree_to_string(Tree tree);
-vector<int> tree_to_vector(Tree &tree);
-
-// Lock-free Debug functions
-void tree_to_vec(TreeNode &node, vector<int> &vec, vector<int> &flags);
-void print_tree(TreeNode &node);
-
-// Helper Functions for Lock-free Operations
-void clear_local_area_insert(TreeNode &node, vector<TreeNode> &flagged_nodes);
-void clear_local_area_delete(TreeNode &node, vector<TreeNode> &flagged_nodes);
-void move_local_area_up_insert(TreeNode &node, vector<TreeNode> &flagged_nodes);
-void move_local_area_up_delete(TreeNode &node, vector<TreeNode> &flagged_nodes);
-bool get_markers_and_flags_above_delete(TreeNode &node);
-// bool get_markers_above_delete(TreeNode &start, bool release);
-// bool get_flags_above_delete();
-
-// Make sure to check the setup succeeded
-bool setup_local_area_insert(TreeNode &node);
-bool setup_local_area_delete(TreeNode &successor, TreeNode &node, vector<TreeNode> &flagged_nodes);
-
-typedef struct Operation {
-  vector<int> values;
-  int type;
-} Operation_t;
-
-// Helper functions
-string operation_to_string(Operation_t operation);
-
-// Parallel tree operations
-void tree_insert_bulk(Tree &tree, vector<int> values, int batch_size, int num_threads);
-void tree_delete_bulk(Tree &tree, vector<int> values, int batch_size, int num_threads);
\ No newline at end of file
+#ifndef RED_BLACK_LOCK_FREE_H
+#define RED_BLACK_LOCK_FREE_H
+
+#include <atomic>
+#include <vector>
+#include <string>
+#include <functional>
+#include <omp.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <initializer_list>
+#include <span>
+#include "node-pool.h"
+#include "tree-common.h"
+#include "frozen-tree.h"
+
+using namespace std;
+
+enum OperationType {
+  INSERT,
+  DELETE,
+  LOOKUP,
+  EMPTY
+};
+
+// With ALIGN_NODES every node gets cache lines of its own, so a writer taking
+// one node's flag never invalidates a neighbouring node another thread is using
+#ifdef ALIGN_NODES
+#define NODE_ALIGNMENT alignas(CACHE_LINE_SIZE)
+#else
+#define NODE_ALIGNMENT
+#endif
+
+// Child pointers are atomic so tree_lookup can follow them without any flags,
+// key never changes once a node is in the tree (value only under the node's flag)
+template <typename Key, typename Value = NoValue>
+struct NODE_ALIGNMENT RedBlackNode {
+  atomic<RedBlackNode*> child[2];
+  RedBlackNode* parent;
+  Key key;
+  [[no_unique_address]] Value value;
+  // Odd while a writer is changing the node's children or value (seqlock for lookups)
+  atomic<unsigned int> version;
+  atomic<bool> flag;
+  bool red;
+  // Set once tree_delete has unlinked the node (under its flag and version)
+  bool removed;
+  // Number of keys in the subtree rooted here, kept only with order statistics
+  // (changed under the node's flag, read without)
+  atomic<int> size;
+};
+
+template <typename Key, typename Value = NoValue, typename Compare = less<Key>>
+struct RedBlackTree {
+  typedef RedBlackNode<Key, Value> *Node;
+
+  // Where nodes come from, null for plain new/delete
+  NodePool_t pool;
+  // Whether nodes keep their subtree sizes, for tree_rank and tree_select, and
+  // the locks that keep writers of the same key from overlapping if so
+  bool order_statistics;
+  atomic<bool> *key_locks;
+  [[no_unique_address]] Compare compare;
+  // Permanent sentinel above the root, which is its left child. Writers flag and
+  // version the link above the root through it like through any other parent, and
+  // it sits on a cache line of its own so that doesn't disturb the fields above
+  alignas(CACHE_LINE_SIZE) RedBlackNode<Key, Value> head;
+  // How many tree_delete calls are moving a predecessor up into a deleted node's
+  // place, and how many such moves have finished (see relocation_snapshot).
+  // Deletes may relocate at the same time, so neither alone tells a search
+  // whether one overlapped it.
+  alignas(CACHE_LINE_SIZE) atomic<unsigned int> relocating;
+  atomic<unsigned int> relocations;
+};
+
+// The int set the drivers and benchmarks use
+typedef RedBlackTree<int> *Tree;
+typedef RedBlackNode<int> *TreeNode;
+
+// A key in the tree and a copy of its value, see tree_lower_bound. Holds no
+// reference into the tree, so it stays safe to use whatever other threads do
+template <typename Key, typename Value = NoValue>
+struct TreeIterator {
+  Key key;
+  [[no_unique_address]] Value value;
+  // False once stepped off either end of the tree
+  bool valid;
+};
+
+// Memory held by a tree, see tree_memory
+typedef struct TreeMemory {
+  size_t nodes;
+  // Bytes allocated for the tree and its nodes (or its node pool's slabs)
+  size_t bytes;
+  double bytes_per_key;
+} TreeMemory_t;
+
+// Keys the bulk operations work through, which any vector of keys (or keys in
+// place in a mapped workload file) converts to
+template <typename Key>
+using KeySpan = span<const type_identity_t<Key>>;
+
+// Tree Functions
+template <typename Key = int, typename Value = NoValue, typename Compare = less<Key>>
+RedBlackTree<Key, Value, Compare> *tree_init(bool use_node_pool = false, bool order_statistics = false,
+                                             Compare compare = Compare());
+template <typename Key, typename Value, typename Compare>
+void tree_free(RedBlackTree<Key, Value, Compare> *&tree, int num_threads = 1);
+template <typename Key, typename Value, typename Compare>
+TreeMemory_t tree_memory(RedBlackTree<Key, Value, Compare> *&tree);
+template <typename Key, typename Value, typename Compare>
+bool tree_insert(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Arg<Value> value = Value());
+template <typename Key, typename Value, typename Compare>
+bool tree_delete(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key);
+template <typename Key, typename Value, typename Compare>
+bool tree_lookup(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key);
+template <typename Key, typename Value, typename Compare>
+size_t tree_lookup_batch(RedBlackTree<Key, Value, Compare> *&tree, const vector<Key> &keys, vector<bool> &results);
+template <typename Key, typename Value, typename Compare>
+bool tree_find(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Value &value);
+template <typename Key, typename Value, typename Compare>
+bool tree_update(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Arg<Value> value);
+template <typename Key, typename Value, typename Compare>
+int tree_lookup_bulk(RedBlackTree<Key, Value, Compare> *&tree, KeySpan<Key> values, int batch_size, int num_threads);
+template <typename Key, typename Value, typename Compare>
+void tree_insert_bulk(RedBlackTree<Key, Value, Compare> *&tree, KeySpan<Key> values, int batch_size, int num_threads);
+template <typename Key, typename Value, typename Compare>
+void tree_delete_bulk(RedBlackTree<Key, Value, Compare> *&tree, KeySpan<Key> values, int batch_size, int num_threads);
+template <typename Key, typename Value, typename Compare>
+bool tree_build_from_sorted(RedBlackTree<Key, Value, Compare> *&tree, const vector<Key> &keys,
+                            const vector<Value> &values = {}, int num_threads = 1);
+template <typename Key, typename Value, typename Compare>
+FrozenTree<Key, Value, Compare> *tree_freeze(RedBlackTree<Key, Value, Compare> *&tree);
+template <typename Key, typename Value, typename Compare>
+size_t tree_rank(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key);
+template <typename Key, typename Value, typename Compare>
+bool tree_select(RedBlackTree<Key, Value, Compare> *&tree, size_t rank, Key &key);
+template <typename Key, typename Value, typename Compare>
+size_t tree_count_range(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> lo, Arg<Key> hi);
+template <typename Key, typename Value, typename Compare, typename Callback>
+size_t tree_range(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> lo, Arg<Key> hi, Callback callback);
+template <typename Key, typename Value, typename Compare>
+TreeIterator<Key, Value> tree_lower_bound(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key);
+template <typename Key, typename Value, typename Compare>
+TreeIterator<Key, Value> tree_upper_bound(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key);
+template <typename Key, typename Value, typename Compare>
+bool tree_successor(RedBlackTree<Key, Value, Compare> *&tree, TreeIterator<Key, Value> &it);
+template <typename Key, typename Value, typename Compare>
+bool tree_predecessor(RedBlackTree<Key, Value, Compare> *&tree, TreeIterator<Key, Value> &it);
+template <typename Key, typename Value, typename Compare>
+size_t tree_insert_batch(RedBlackTree<Key, Value, Compare> *&tree, vector<Key> keys, vector<Value> values = {},
+                         int num_threads = 1);
+template <typename Key, typename Value, typename Compare>
+size_t tree_delete_batch(RedBlackTree<Key, Value, Compare> *&tree, vector<Key> keys, int num_threads = 1);
+
+// (Sequential) Debug Functions
+template <typename Key, typename Value, typename Compare>
+int tree_size(RedBlackTree<Key, Value, Compare> *&tree);
+template <typename Key, typename Value, typename Compare>
+bool tree_validate(RedBlackTree<Key, Value, Compare> *&tree);
+template <typename Key, typename Value, typename Compare>
+string tree_to_string(RedBlackTree<Key, Value, Compare> *tree);
+template <typename Key, typename Value, typename Compare>
+vector<Key> tree_to_vector(RedBlackTree<Key, Value, Compare> *&tree);
+
+// Lock-free Debug functions
+template <typename Key, typename Value>
+void tree_to_vec(RedBlackNode<Key, Value> *node, vector<Key> &vec, vector<int> &flags);
+template <typename Key, typename Value>
+void print_tree(RedBlackNode<Key, Value> *node);
+
+// Helper Functions for Lock-free Operations, for any node type
+// (The link above the root is guarded by the tree's head node)
+template <typename Node>
+void flag_node(Node node);
+template <typename Node>
+void unflag_node(Node node);
+template <typename Node>
+void add_to_local_area(Node node, vector<Node> &flagged_nodes);
+template <typename Node>
+void shrink_local_area(vector<Node> &flagged_nodes, initializer_list<Node> keep);
+template <typename Node>
+void clear_local_area(vector<Node> &flagged_nodes);
+template <typename Node>
+void begin_modify(Node node);
+template <typename Node>
+void end_modify(Node node);
+template <typename Key, typename Value>
+void free_tree_node(NodePool_t pool, void *node);
+
+// Epoch-based Memory Reclamation
+void epoch_enter();
+void epoch_exit();
+void epoch_retire(void *node, void (*free_node)(NodePool_t, void *), NodePool_t pool);
+void epoch_flush();
+size_t epoch_pending();
+
+// Contention Management: how a thread waits to try again at something another
+// thread holds (a flag, a key lock, or a node a lookup has to read again)
+typedef struct ContentionManager {
+  // Pause for between half and all of min_pause spins, doubling with every
+  // attempt up to max_pause
+  unsigned int min_pause;
+  unsigned int max_pause;
+  // Yield the core instead after this many attempts, so the holder gets to run
+  // when threads outnumber cores
+  unsigned int yield_after;
+} ContentionManager_t;
+
+// Waits of all threads since the last contention_reset_stats
+typedef struct ContentionStats {
+  // Times a thread had to wait to try again, and how many of them yielded
+  uint64_t retries;
+  uint64_t yields;
+  // Most attempts any one wait took
+  uint64_t max_attempts;
+} ContentionStats_t;
+
+// One wait, started with attempts = 0
+typedef struct Backoff {
+  unsigned int attempts;
+} Backoff_t;
+
+void backoff_wait(Backoff_t &backoff);
+void contention_configure(ContentionManager_t manager);
+ContentionManager_t contention_manager();
+ContentionStats_t contention_stats();
+void contention_reset_stats();
+
+// Instrumentation, counted per thread only when built with -DTREE_STATS
+// (make parallel STATS=1) and summed over all threads by tree_stats
+#define FIXUP_DEPTH_BUCKETS 8
+typedef struct TreeStats {
+  uint64_t inserts;
+  uint64_t deletes;
+  // Optimistic reads that had to start over because the tree changed underneath
+  uint64_t restarts;
+  // Failed attempts at taking a flag or key lock
+  uint64_t cas_failures;
+  // Pause iterations and yields spent backing off
+  uint64_t spin_iterations;
+  uint64_t rotations;
+  // Color flips (a node and its children, or a parent, sibling and node)
+  uint64_t recolorings;
+  // Inserts and deletes by how many levels they rebalanced at (rotated or
+  // flipped colors) on their way down, the last bucket counts that many or more
+  uint64_t fixup_depth[FIXUP_DEPTH_BUCKETS];
+} TreeStats_t;
+
+TreeStats_t *tree_stats_claim();
+TreeStats_t tree_stats();
+void tree_stats_reset();
+
+// A run of one operation type from a test case, its keys held by the Workload it
+// was loaded from (see workload.h)
+typedef struct Operation {
+  span<const int> values;
+  int type;
+} Operation_t;
+
+// Helper functions
+string operation_to_string(Operation_t operation);
+
+// Template definitions
+#include "utils-lock-free.h"
+#include "red-black-lock-free-impl.h"
+#include "join-lock-free.h"
+
+#endif
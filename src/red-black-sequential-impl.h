@@ -0,0 +1,819 @@
+#include <stdio.h>
+#include <memory>
+
+using namespace std;
+
+// The following was adapted from pseudocode presented in
+// https://en.wikipedia.org/wiki/Red%E2%80%93black_tree
+
+// Points node back at parent, unless nodes don't keep parent pointers
+template <typename Key, typename Value>
+inline void set_parent(RedBlackNode<Key, Value> *node, RedBlackNode<Key, Value> *parent) {
+#ifndef NO_PARENT_POINTERS
+  node->parent = parent;
+#else
+  (void)node;
+  (void)parent;
+#endif
+}
+
+template <typename Key, typename Value, typename Compare>
+inline RedBlackNode<Key, Value> *newTreeNode(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Arg<Value> value,
+                                             bool red, typename RedBlackTree<Key, Value, Compare>::Node parent,
+                                             typename RedBlackTree<Key, Value, Compare>::Node left,
+                                             typename RedBlackTree<Key, Value, Compare>::Node right) {
+  typedef RedBlackNode<Key, Value> Node;
+  Node *node = tree->pool ? new (pool_alloc(tree->pool)) Node{.child = {left, right}, .key = key, .value = value,
+                                                              .red = red, .size = 1}
+                          : new Node{.child = {left, right}, .key = key, .value = value, .red = red, .size = 1};
+  set_parent(node, parent);
+  return node;
+}
+
+template <typename Key, typename Value, typename Compare>
+inline void freeTreeNode(RedBlackTree<Key, Value, Compare> *&tree, RedBlackNode<Key, Value> *node) {
+  if (tree->pool) {
+    destroy_at(node);
+    pool_free(tree->pool, node);
+  } else {
+    delete node;
+  }
+}
+
+// Returns which side of other key belongs on through the tree's Compare (1 for
+// the right), setting equal if they are the same key. Both comparisons are always
+// made so searches only branch on the (rarely true) equal case.
+template <typename Key, typename Value, typename Compare>
+inline int key_direction(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Arg<Key> other, bool &equal) {
+  bool right = tree->compare(other, key);
+  bool left = tree->compare(key, other);
+  equal = !(left | right);
+  return right;
+}
+
+// Size of the subtree rooted at node, for trees with order statistics
+template <typename Key, typename Value>
+inline int node_size(RedBlackNode<Key, Value> *node) {
+  return node ? node->size : 0;
+}
+
+#ifndef NO_PARENT_POINTERS
+// Adds delta to the size of node and every node above it
+template <typename Key, typename Value>
+void add_to_sizes(RedBlackNode<Key, Value> *node, int delta) {
+  for (; node; node = node->parent) {
+    node->size += delta;
+  }
+}
+
+template <typename Key, typename Value, typename Compare>
+RedBlackNode<Key, Value> *rotateDir(RedBlackTree<Key, Value, Compare> *&tree, RedBlackNode<Key, Value> *root, int dir) {
+  typedef RedBlackNode<Key, Value> *Node;
+  Node parent = root->parent;
+  Node rotatingChild = root->child[1-dir];
+  // assert(rotatingChild);
+  Node C = rotatingChild->child[dir];
+  root->child[1-dir] = C;
+  if (C) {
+    C->parent = root;
+  }
+  rotatingChild->child[dir] = root;
+
+  root->parent = rotatingChild;
+  rotatingChild->parent = parent;
+  if (parent) {
+    parent->child[root == parent->child[1]] = rotatingChild;
+  } else {
+    tree->root = rotatingChild;
+  }
+
+  // The rising child takes over the whole subtree, root keeps what's left of it
+  if (tree->order_statistics) {
+    rotatingChild->size = root->size;
+    root->size = node_size(root->child[0]) + node_size(root->child[1]) + 1;
+  }
+  return rotatingChild;
+}
+#endif
+
+// Initializes an empty tree, whose nodes come from a node pool if use_node_pool
+// is set (and from new/delete otherwise) and keep their subtree sizes if
+// order_statistics is set
+template <typename Key, typename Value, typename Compare>
+RedBlackTree<Key, Value, Compare> *tree_init(bool use_node_pool, bool order_statistics, Compare compare) {
+  RedBlackTree<Key, Value, Compare> *tree = new RedBlackTree<Key, Value, Compare>();
+  tree->root = nullptr;
+  tree->pool = use_node_pool ? pool_init(sizeof(RedBlackNode<Key, Value>)) : nullptr;
+  tree->order_statistics = order_statistics;
+  tree->compare = compare;
+  return tree;
+}
+
+template <typename Key, typename Value, typename Compare>
+void free_subtree(RedBlackTree<Key, Value, Compare> *&tree, RedBlackNode<Key, Value> *root) {
+  if (!root) return;
+  free_subtree(tree, root->child[0]);
+  free_subtree(tree, root->child[1]);
+  freeTreeNode(tree, root);
+}
+
+// Frees the tree and all of its nodes
+template <typename Key, typename Value, typename Compare>
+void tree_free(RedBlackTree<Key, Value, Compare> *&tree) {
+  // Pooled nodes with nothing to destroy go with the pool's slabs, all at once
+  if (!tree->pool || !is_trivially_destructible<RedBlackNode<Key, Value>>::value) {
+    free_subtree(tree, tree->root);
+  }
+  if (tree->pool) {
+    pool_destroy(tree->pool);
+  }
+  delete tree;
+  tree = nullptr;
+}
+
+// Returns the number of nodes in the tree and the memory it holds (not counting
+// memory owned by the keys and values themselves)
+template <typename Key, typename Value, typename Compare>
+TreeMemory_t tree_memory(RedBlackTree<Key, Value, Compare> *&tree) {
+  TreeMemory_t memory;
+  memory.nodes = tree_size(tree);
+  memory.bytes = sizeof(RedBlackTree<Key, Value, Compare>);
+  memory.bytes += tree->pool ? pool_bytes(tree->pool) : memory.nodes * sizeof(RedBlackNode<Key, Value>);
+  memory.bytes_per_key = memory.nodes ? (double)memory.bytes / memory.nodes : 0;
+  return memory;
+}
+
+
+
+template <typename Key, typename Value>
+string subtreeToString(RedBlackNode<Key, Value> *root) {
+  if (!root) {
+    return "Empty";
+  }
+  if (root->red)
+    return "RED(" + subtreeToString(root->child[0]) + ", " + key_to_string(root->key) + ", " + subtreeToString(root->child[1]) + ")";
+  else
+    return "BLACK(" + subtreeToString(root->child[0]) + ", " + key_to_string(root->key) + ", " + subtreeToString(root->child[1]) + ")";
+}
+
+template <typename Key, typename Value, typename Compare>
+string tree_to_string(RedBlackTree<Key, Value, Compare> *T) {
+  return subtreeToString(T->root);
+}
+
+template <typename Key, typename Value>
+int size_subtree(RedBlackNode<Key, Value> *root) {
+  if (!root) return 0;
+  return 1 + size_subtree(root->child[0]) + size_subtree(root->child[1]);
+}
+
+template <typename Key, typename Value>
+void inord_tree_to_vec_helper(RedBlackNode<Key, Value> *T, vector <Key> &res) {
+  if (!T) return;
+  inord_tree_to_vec_helper(T->child[0], res);
+  res.push_back(T->key);
+  inord_tree_to_vec_helper(T->child[1], res);
+}
+
+template <typename Key, typename Value, typename Compare>
+vector <Key> tree_to_vector(RedBlackTree<Key, Value, Compare> *&T) {
+  RedBlackNode<Key, Value> *root = T->root;
+  vector <Key> res;
+  if (!root) return res;
+
+  inord_tree_to_vec_helper(root, res);
+
+  return res;
+}
+
+template <typename Key, typename Value, typename Compare>
+int tree_size(RedBlackTree<Key, Value, Compare> *&tree) {
+  return size_subtree(tree->root);
+}
+
+// Return Whether Red-Black Tree Rooted at root is valid
+// If it is valid, also return the number of black nodes to any Empty,
+// including this info allows validation to be written recursively
+template <typename Key, typename Value, typename Compare>
+bool validateAtBlackDepth(RedBlackTree<Key, Value, Compare> *&tree, RedBlackNode<Key, Value> *root,
+                          int *blackDepth, const Key *lo, const Key *hi) {
+  // (Base Case) Leaves are Valid
+  if (!root) {
+    *blackDepth = 0;
+    return true;
+  }
+
+  // Root must follow BST invariant
+  if ((lo && !tree->compare(*lo, root->key)) || (hi && !tree->compare(root->key, *hi))) {
+    printf("BST Invariant Failed at %s! \n", key_to_string(root->key).c_str());
+    return false;
+  }
+
+  // Red Nodes Cannot have Red Children
+  RedBlackNode<Key, Value> *left = root->child[0], *right = root->child[1];
+  if (root->red && ((left && left->red) || (right && right->red))) {
+    printf("Red Children Invariant Failed at %s! \n", key_to_string(root->key).c_str());
+    return false;
+  }
+
+#ifndef NO_PARENT_POINTERS
+  // Children Must Point back to their Parents
+  if ((left && left->parent != root) || (right && right->parent != root)) {
+    printf("Orphaned Children at %s! \n", key_to_string(root->key).c_str());
+    return false;
+  }
+#endif
+
+  // Left and right subtrees must be valid red-black trees
+  int leftDepth = 0, rightDepth = 0;
+  bool leftValid = validateAtBlackDepth(tree, left, &leftDepth, lo, &(root->key));
+  bool rightValid = validateAtBlackDepth(tree, right, &rightDepth, &(root->key), hi);
+
+  if (!leftValid || !rightValid) {
+    return false;
+  }
+
+  // Black depth must be the same for both children
+  if (leftDepth != rightDepth) {
+    printf("Black Depth Invariant Failed at %s! \n", key_to_string(root->key).c_str());
+    return false;
+  }
+
+  // Sizes must add up, if the tree keeps them
+  if (tree->order_statistics && root->size != node_size(left) + node_size(right) + 1) {
+    printf("Subtree Size Invariant Failed at %s! \n", key_to_string(root->key).c_str());
+    return false;
+  }
+
+  *blackDepth = leftDepth + !(root->red);
+  return true;
+}
+
+// Return whether Red-Black Tree Rooted at root is valid
+template <typename Key, typename Value, typename Compare>
+bool tree_validate(RedBlackTree<Key, Value, Compare> *&tree) {
+#ifndef NO_PARENT_POINTERS
+  if (tree->root && tree->root->parent) {
+    printf("Root has a parent!\n");
+    return false;
+  }
+#endif
+  int blackDepth = 0;
+  return validateAtBlackDepth(tree, tree->root, &blackDepth, (const Key *)nullptr, (const Key *)nullptr);
+}
+
+// Returns the node holding key, or null if key isn't in the tree
+template <typename Key, typename Value, typename Compare>
+RedBlackNode<Key, Value> *lookup_node(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key) {
+  RedBlackNode<Key, Value> *node = tree->root;
+  while (node) {
+    bool equal;
+    int dir = key_direction(tree, key, node->key, equal);
+    if (equal) {
+      return node;
+    }
+    node = node->child[dir];
+  }
+  return nullptr;
+}
+
+// Return whether a node with given key exists in a Red-Black Tree
+template <typename Key, typename Value, typename Compare>
+bool tree_lookup(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key) {
+  return lookup_node(tree, key) != nullptr;
+}
+
+// Looks up every key in keys, setting results[i] to whether keys[i] is in the
+// tree, returns how many were. LOOKUP_BATCH searches at a time go down the tree
+// in lockstep, each prefetching the node it steps to, so by the time a search
+// comes back round to that node the other searches have hidden its cache miss.
+template <typename Key, typename Value, typename Compare>
+size_t tree_lookup_batch(RedBlackTree<Key, Value, Compare> *&tree, const vector<Key> &keys, vector<bool> &results) {
+  RedBlackNode<Key, Value> *nodes[LOOKUP_BATCH];
+  size_t found = 0;
+  results.assign(keys.size(), false);
+  for (size_t start = 0; start < keys.size(); start += LOOKUP_BATCH) {
+    size_t count = min((size_t)LOOKUP_BATCH, keys.size() - start);
+    fill(nodes, nodes + count, tree->root);
+    bool searching = tree->root;
+    while (searching) {
+      searching = false;
+      for (size_t i = 0; i < count; i++) {
+        RedBlackNode<Key, Value> *node = nodes[i];
+        if (!node) continue;
+        bool equal;
+        int dir = key_direction(tree, keys[start + i], node->key, equal);
+        if (equal) {
+          results[start + i] = true;
+          found++;
+          node = nullptr;
+        } else {
+          node = node->child[dir];
+          __builtin_prefetch(node);
+        }
+        nodes[i] = node;
+        searching |= node != nullptr;
+      }
+    }
+  }
+  return found;
+}
+
+// Copies the value stored with key into value, returns false if key isn't in the tree
+template <typename Key, typename Value, typename Compare>
+bool tree_find(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Value &value) {
+  RedBlackNode<Key, Value> *node = lookup_node(tree, key);
+  if (!node) {
+    return false;
+  }
+  value = node->value;
+  return true;
+}
+
+// Replaces the value stored with key in place, returns false if key isn't in the tree
+template <typename Key, typename Value, typename Compare>
+bool tree_update(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Arg<Value> value) {
+  RedBlackNode<Key, Value> *node = lookup_node(tree, key);
+  if (!node) {
+    return false;
+  }
+  node->value = value;
+  return true;
+}
+
+// Returns the first node whose key isn't less than key (greater than key unless
+// inclusive), or null if there is none
+template <typename Key, typename Value, typename Compare>
+RedBlackNode<Key, Value> *bound_node(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, bool inclusive) {
+  RedBlackNode<Key, Value> *node = tree->root;
+  RedBlackNode<Key, Value> *bound = nullptr;
+  while (node) {
+    bool equal;
+    int dir = key_direction(tree, key, node->key, equal);
+    if (equal) {
+      if (inclusive) return node;
+      dir = 1;
+    }
+    // Every node we pass on its left is a candidate, the deepest one is the bound
+    if (!dir) bound = node;
+    node = node->child[dir];
+  }
+  return bound;
+}
+
+// Node at the first key not less than key, null if there is none
+// Nodes double as iterators: null stands for past either end of the tree
+template <typename Key, typename Value, typename Compare>
+typename RedBlackTree<Key, Value, Compare>::Node tree_lower_bound(RedBlackTree<Key, Value, Compare> *&tree,
+                                                                  Arg<Key> key) {
+  return bound_node(tree, key, true);
+}
+
+// Node at the first key greater than key, null if there is none
+template <typename Key, typename Value, typename Compare>
+typename RedBlackTree<Key, Value, Compare>::Node tree_upper_bound(RedBlackTree<Key, Value, Compare> *&tree,
+                                                                  Arg<Key> key) {
+  return bound_node(tree, key, false);
+}
+
+// Returns the node after node in direction dir (1 for ascending order), or the
+// first one from the other end of the tree if node is null
+template <typename Key, typename Value, typename Compare>
+RedBlackNode<Key, Value> *step_node(RedBlackTree<Key, Value, Compare> *&tree, RedBlackNode<Key, Value> *node,
+                                    int dir) {
+  if (!node || node->child[dir]) {
+    // Leftmost (for dir 1) node of the subtree in direction dir
+    RedBlackNode<Key, Value> *next = node ? node->child[dir] : tree->root;
+    while (next && next->child[1-dir]) {
+      next = next->child[1-dir];
+    }
+    return next;
+  }
+#ifndef NO_PARENT_POINTERS
+  // Otherwise the first ancestor we reach coming up from its other side
+  while (node->parent && node->parent->child[dir] == node) {
+    node = node->parent;
+  }
+  return node->parent;
+#else
+  // Otherwise the deepest node we pass on its other side searching from the root
+  RedBlackNode<Key, Value> *next = nullptr;
+  for (RedBlackNode<Key, Value> *iter = tree->root; iter;) {
+    bool equal;
+    int next_dir = key_direction(tree, node->key, iter->key, equal);
+    if (equal) next_dir = dir;
+    if (next_dir != dir) next = iter;
+    iter = iter->child[next_dir];
+  }
+  return next;
+#endif
+}
+
+// Node after node in key order, or the first node if node is null
+template <typename Key, typename Value, typename Compare>
+typename RedBlackTree<Key, Value, Compare>::Node tree_successor(RedBlackTree<Key, Value, Compare> *&tree,
+                                                                typename RedBlackTree<Key, Value, Compare>::Node node) {
+  return step_node(tree, node, 1);
+}
+
+// Node before node in key order, or the last node if node is null
+template <typename Key, typename Value, typename Compare>
+typename RedBlackTree<Key, Value, Compare>::Node tree_predecessor(RedBlackTree<Key, Value, Compare> *&tree,
+                                                                  typename RedBlackTree<Key, Value, Compare>::Node node) {
+  return step_node(tree, node, 0);
+}
+
+// Calls callback(key, value) for every key in [lo, hi] in ascending order,
+// returns how many keys it was called for
+template <typename Key, typename Value, typename Compare, typename Callback>
+size_t tree_range(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> lo, Arg<Key> hi, Callback callback) {
+  size_t visited = 0;
+  for (RedBlackNode<Key, Value> *node = bound_node(tree, lo, true); node && !tree->compare(hi, node->key);
+       node = step_node(tree, node, 1)) {
+    callback(node->key, node->value);
+    visited++;
+  }
+  return visited;
+}
+
+// Returns how many keys in the tree are less than key (or not greater than key
+// if inclusive), in O(log n) with order statistics and O(n) without
+template <typename Key, typename Value, typename Compare>
+size_t rank_of(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, bool inclusive) {
+  size_t rank = 0;
+  if (!tree->order_statistics) {
+    for (RedBlackNode<Key, Value> *node = step_node(tree, (RedBlackNode<Key, Value> *)nullptr, 1);
+         node && (inclusive ? !tree->compare(key, node->key) : tree->compare(node->key, key));
+         node = step_node(tree, node, 1)) {
+      rank++;
+    }
+    return rank;
+  }
+
+  RedBlackNode<Key, Value> *node = tree->root;
+  while (node) {
+    bool equal;
+    int dir = key_direction(tree, key, node->key, equal);
+    if (equal) {
+      return rank + node_size(node->child[0]) + inclusive;
+    }
+    // Going right passes node and everything to its left
+    if (dir) {
+      rank += node_size(node->child[0]) + 1;
+    }
+    node = node->child[dir];
+  }
+  return rank;
+}
+
+// Returns how many keys in the tree are less than key
+template <typename Key, typename Value, typename Compare>
+size_t tree_rank(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key) {
+  return rank_of(tree, key, false);
+}
+
+// Sets key to the key with the given rank (the smallest has rank 0), returns false
+// if the tree doesn't have that many keys
+template <typename Key, typename Value, typename Compare>
+bool tree_select(RedBlackTree<Key, Value, Compare> *&tree, size_t rank, Key &key) {
+  RedBlackNode<Key, Value> *node = tree->root;
+  if (!tree->order_statistics) {
+    node = step_node(tree, (RedBlackNode<Key, Value> *)nullptr, 1);
+    for (; node && rank > 0; rank--) {
+      node = step_node(tree, node, 1);
+    }
+  } else {
+    while (node) {
+      size_t left_size = node_size(node->child[0]);
+      if (rank == left_size) break;
+      if (rank < left_size) {
+        node = node->child[0];
+      } else {
+        rank -= left_size + 1;
+        node = node->child[1];
+      }
+    }
+  }
+  if (!node) return false;
+  key = node->key;
+  return true;
+}
+
+// Returns how many keys in the tree are in [lo, hi]
+template <typename Key, typename Value, typename Compare>
+size_t tree_count_range(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> lo, Arg<Key> hi) {
+  if (tree->compare(hi, lo)) return 0;
+  return rank_of(tree, hi, true) - rank_of(tree, lo, false);
+}
+
+#ifndef NO_PARENT_POINTERS
+// Inserts key (with value) into Tree, returns True if Node Inserted (i.e. wasn't
+// already present, an existing key keeps its value)
+template <typename Key, typename Value, typename Compare>
+bool tree_insert(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Arg<Value> value) {
+  typedef RedBlackNode<Key, Value> *Node;
+  // Edge Case: Set root of Empty tree
+  if (!tree->root) {
+    tree->root = newTreeNode(tree, key, value, true, nullptr, nullptr, nullptr);
+    return true;
+  }
+
+  // Search down to find where node would be
+  Node iter = tree->root;
+  Node parent = tree->root->parent;
+  int dir = 0;
+
+  while (iter) {
+    parent = iter;
+
+    bool equal;
+    dir = key_direction(tree, key, iter->key, equal);
+    if (equal) {
+      return false;
+    } else {
+      iter = iter->child[dir];
+      // Insert into left child if dir is 0, right child if 1
+    }
+  }
+
+  // Place Node Where it Would be in the Tree Assuming No Rebalancing
+  Node node = newTreeNode(tree, key, value, true, parent, nullptr, nullptr);
+  parent->child[dir] = node;
+  if (tree->order_statistics) {
+    add_to_sizes(parent, 1);
+  }
+
+  // Go Through the Cases of Tree Insertion
+  // Source: https://en.wikipedia.org/wiki/Red%E2%80%93black_tree#Insertion
+  Node grandparent;
+  Node uncle;
+  while (node->parent) {
+    // If Parent is Black, Chilling (I1)
+    if (!parent->red) {
+      return true;
+    }
+
+    // If Parent is Red Root, Turn Black and Return (I4)
+    grandparent = parent->parent;
+    if (!grandparent) {
+      parent->red = false;
+      return true;
+    }
+
+    // Define Uncle as Grandparent's Other Child
+    dir = parent == grandparent->child[1];
+    uncle = grandparent->child[1-dir];
+    if (!uncle || !uncle->red) {
+      // (I5 & I6)
+      if (node == parent->child[1-dir]) {
+        rotateDir(tree, parent, dir);
+        node = parent;
+        parent = grandparent->child[dir];
+      }
+
+      rotateDir(tree, grandparent, 1-dir);
+      parent->red = false;
+      grandparent->red = true;
+      return true;
+    }
+
+    // Parent and Uncle Both Red, Swap Parent + Grandparent Colors (I2)
+    parent->red = false;
+    uncle->red = false;
+    grandparent->red = true;
+
+    node = grandparent;
+    parent = node->parent;
+  }
+
+  // If We're the Root, Done (I3)
+  return true;
+}
+#endif
+
+// Builds a perfectly balanced subtree from keys[lo, hi) (and the matching values,
+// if any) whose root is at the given depth below parent. Only the nodes on the
+// deepest level of the whole tree (red_depth) are red, so every path from the
+// root has the same number of black nodes.
+template <typename Key, typename Value, typename Compare>
+RedBlackNode<Key, Value> *build_subtree(RedBlackTree<Key, Value, Compare> *&tree, const vector<Key> &keys,
+                                        const vector<Value> &values, size_t lo, size_t hi, int depth,
+                                        int red_depth, RedBlackNode<Key, Value> *parent) {
+  if (lo >= hi) return nullptr;
+  size_t mid = lo + (hi - lo) / 2;
+  RedBlackNode<Key, Value> *node = newTreeNode(tree, keys[mid], values.empty() ? Value() : values[mid],
+                                               depth == red_depth && depth > 0, parent, nullptr, nullptr);
+  node->size = hi - lo;
+  node->child[0] = build_subtree(tree, keys, values, lo, mid, depth + 1, red_depth, node);
+  node->child[1] = build_subtree(tree, keys, values, mid + 1, hi, depth + 1, red_depth, node);
+  return node;
+}
+
+// Fills an empty tree with keys, which must be sorted and unique under the tree's
+// Compare, in O(n) instead of n inserts. values, if given, holds the value for
+// each key. Returns false, leaving the tree empty, if the tree wasn't empty or
+// keys aren't strictly increasing.
+template <typename Key, typename Value, typename Compare>
+bool tree_build_from_sorted(RedBlackTree<Key, Value, Compare> *&tree, const vector<Key> &keys,
+                            const vector<Value> &values) {
+  size_t n = keys.size();
+  if (tree->root || (!values.empty() && values.size() != n)) return false;
+  for (size_t i = 1; i < n; i++) {
+    if (!tree->compare(keys[i - 1], keys[i])) return false;
+  }
+
+  // Splitting at the middle leaves every leaf on the last one or two levels
+  int red_depth = 0;
+  while (((size_t)2 << red_depth) <= n) red_depth++;
+  tree->root = build_subtree(tree, keys, values, 0, n, 0, red_depth, (RedBlackNode<Key, Value> *)nullptr);
+  return true;
+}
+
+// In-order keys and values of the subtree rooted at node
+template <typename Key, typename Value>
+void collect_subtree(RedBlackNode<Key, Value> *node, vector<Key> &keys, vector<Value> &values) {
+  if (!node) return;
+  collect_subtree(node->child[0], keys, values);
+  keys.push_back(node->key);
+  if (!is_empty<Value>::value) values.push_back(node->value);
+  collect_subtree(node->child[1], keys, values);
+}
+
+// Returns a read-only copy of the tree laid out for fast lookups (see
+// frozen-tree.h), which later changes to the tree don't affect
+template <typename Key, typename Value, typename Compare>
+FrozenTree<Key, Value, Compare> *tree_freeze(RedBlackTree<Key, Value, Compare> *&tree) {
+  vector<Key> keys;
+  vector<Value> values;
+  collect_subtree(tree->root, keys, values);
+  return frozen_build(std::move(keys), std::move(values), tree->compare);
+}
+
+#ifndef NO_PARENT_POINTERS
+// DELETE HELPER FUNCTIONS (As per Wikipedia)
+template <typename Key, typename Value, typename Compare>
+bool delete_case_6(RedBlackTree<Key, Value, Compare> *&tree, RedBlackNode<Key, Value> *parent,
+                   RedBlackNode<Key, Value> *sibling, RedBlackNode<Key, Value> *distant_nephew, int dir) {
+  rotateDir(tree, parent, dir);
+  sibling->red = parent->red;
+  parent->red = false;
+  distant_nephew->red = false;
+  return true;
+}
+
+template <typename Key, typename Value, typename Compare>
+bool delete_case_5(RedBlackTree<Key, Value, Compare> *&tree, RedBlackNode<Key, Value> *parent,
+                   RedBlackNode<Key, Value> *sibling, RedBlackNode<Key, Value> *close_nephew,
+                   RedBlackNode<Key, Value> *distant_nephew, int dir) {
+  rotateDir(tree, sibling, 1-dir);
+  sibling->red = true;
+  close_nephew->red = false;
+  distant_nephew = sibling;
+  sibling = close_nephew;
+  return delete_case_6(tree, parent, sibling, distant_nephew, dir);
+}
+
+template <typename Key, typename Value>
+bool delete_case_4(RedBlackNode<Key, Value> *&sibling, RedBlackNode<Key, Value> *&parent) {
+  sibling->red = true;
+  parent->red = false;
+  return true;
+}
+
+template <typename Key, typename Value, typename Compare>
+bool delete_case_3(RedBlackTree<Key, Value, Compare> *&tree, RedBlackNode<Key, Value> *parent,
+                   RedBlackNode<Key, Value> *sibling, RedBlackNode<Key, Value> *close_nephew,
+                   RedBlackNode<Key, Value> *distant_nephew, int dir) {
+  rotateDir(tree, parent, dir);
+  parent->red = true;
+  sibling->red = false;
+  sibling = close_nephew;
+  // now: P red && S black
+  distant_nephew = sibling->child[1-dir];
+  if (distant_nephew && distant_nephew->red)
+    return delete_case_6(tree, parent, sibling, distant_nephew, dir);
+  close_nephew = sibling->child[dir]; // close   nephew
+  if (close_nephew && close_nephew->red)
+    return delete_case_5(tree, parent, sibling, close_nephew, distant_nephew, dir);
+  return delete_case_4(sibling, parent);
+}
+
+template <typename Key, typename Value, typename Compare>
+bool tree_delete(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key) {
+  typedef RedBlackNode<Key, Value> *Node;
+  // Don't delete from an empty tree
+  if (!tree->root) {
+    return false;
+  }
+
+  // Search down to find where node would be
+  Node node;
+  Node iter = tree->root;
+  Node parent = tree->root->parent;
+
+  while (iter) {
+    bool equal;
+    int dir = key_direction(tree, key, iter->key, equal);
+    if (equal) {
+      break;
+    } else {
+      // Delete from left child if dir is 0, right child if 1
+      parent = iter;
+      iter = iter->child[dir];
+    }
+  }
+  // If we never found the node to delete, don't delete it
+  node = iter;
+  if (!node) {
+    return false;
+  }
+
+  // Two Node Case
+  if (node->child[0] && node->child[1]) {
+    // Find in-order successor of Node
+    iter = node->child[1];
+    while (iter->child[0]) {
+      iter = iter->child[0];
+    }
+    node->key = std::move(iter->key);
+    node->value = std::move(iter->value);
+    node = iter;
+    parent = node->parent;
+  }
+
+  // Node is the one that actually leaves the tree
+  if (tree->order_statistics) {
+    add_to_sizes(parent, -1);
+  }
+
+  Node left_child = node->child[0];
+  Node right_child = node->child[1];
+  Node child = left_child ? left_child : right_child;
+
+  // One Node Case
+  if (child) {
+    // Replace Node with its extant child
+    if (parent) {
+      // Node had parent, set parent's child
+      bool dir = parent->child[1] == node;
+      parent->child[dir] = child;
+      child->parent = parent;
+    } else {
+      // Node was root, set root
+      tree->root = child;
+      child->parent = nullptr;
+    }
+    child->red = false;
+    freeTreeNode(tree, node);
+    return true;
+  }
+
+  // Node has no children
+  // If Node is the root, just delete it
+  if (node == tree->root) {
+    tree->root = nullptr;
+    freeTreeNode(tree, node);
+    return true;
+  }
+
+  // If Node is red, just delete it
+  if (node->red) {
+    parent->child[parent->child[1] == node] = nullptr;
+    freeTreeNode(tree, node);
+    return true;
+  }
+
+  // Node is childless and black (Delete Node and Rebalance)
+  int dir = parent->child[1] == node;
+  parent->child[dir] = nullptr;
+  Node tmp = node;
+  node = nullptr;
+  freeTreeNode(tree, tmp);
+
+  Node sibling, close_nephew, distant_nephew;
+  while (node != tree->root) {
+    dir = parent->child[1] == node;
+    sibling = parent->child[1-dir];
+    distant_nephew = sibling->child[1-dir];
+    close_nephew = sibling->child[dir];
+    if (sibling->red) {
+      // Case D3
+      return delete_case_3(tree, parent, sibling, close_nephew, distant_nephew, dir);
+    } else if (distant_nephew && distant_nephew->red) {
+      // Case D6
+      return delete_case_6(tree, parent, sibling, distant_nephew, dir);
+    } else if (close_nephew && close_nephew->red) {
+      // Case D5
+      return delete_case_5(tree, parent, sibling, close_nephew, distant_nephew, dir);
+    } else if (parent->red) {
+      // Case D4
+      return delete_case_4(sibling, parent);
+    }
+    sibling->red = true;
+    node = parent;
+    parent = node->parent;
+  }
+  return true;
+
+}
+#endif
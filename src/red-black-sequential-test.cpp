@@ -2,6 +2,10 @@
 #include <fstream>
 #include <string>
 #include <set>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <climits>
 
 #include <unistd.h>
 
@@ -43,9 +47,10 @@ vector<int> generate_rand_input(int length = 1000) {
 int main(int argc, char *argv[]) {
   // Command Line Input Code (adapted from Assn 3)
   int opt;
-  bool insert_test = false, mixed_test = false;
+  bool insert_test = false, mixed_test = false, lookup_benchmark = false;
+  bool use_node_pool = false;
   int num_operations = 0;
-  while ((opt = getopt(argc, argv, "i:m:")) != -1) {
+  while ((opt = getopt(argc, argv, "i:m:r:p")) != -1) {
     switch (opt) {
       case 'i':
         insert_test = true;
@@ -55,17 +60,95 @@ int main(int argc, char *argv[]) {
         mixed_test = true;
         num_operations = atoi(optarg);
         break;
+      case 'r':
+        lookup_benchmark = true;
+        num_operations = atoi(optarg);
+        break;
+      case 'p':
+        use_node_pool = true;
+        break;
       default:
-        fprintf(stderr, "Usage: %s -i / -m \n", argv[0]);
+        fprintf(stderr, "Usage: %s -i / -m / -r num_keys (benchmark lookups) [-p (use node pool)]\n", argv[0]);
         exit(EXIT_FAILURE);
     }
   }
-  // Should only specify one of i, m
-  if (insert_test + mixed_test != 1) {
-    fprintf(stderr, "Usage: %s -i / -m \n", argv[0]);
+  // Should only specify one of i, m, r
+  if (insert_test + mixed_test + lookup_benchmark != 1) {
+    fprintf(stderr, "Usage: %s -i / -m / -r \n", argv[0]);
     exit(EXIT_FAILURE);
   }
 
+  // Lookup benchmark: insert num_keys random keys, then look up as many keys
+  // half of which are (usually) misses, and report memory per key
+  if (lookup_benchmark) {
+    vector<int> keys = generate_rand_input(num_operations);
+    Tree tree = tree_init(use_node_pool);
+    for (int key : keys) {
+      tree_insert(tree, key);
+    }
+    vector<int> lookups(num_operations);
+    for (int i = 0; i < num_operations; i++) {
+      lookups[i] = keys[rand() % keys.size()] + (i & 1);
+    }
+    size_t found = 0;
+    const auto lookup_start = chrono::steady_clock::now();
+    for (int key : lookups) {
+      found += tree_lookup(tree, key);
+    }
+    const auto lookup_end = chrono::steady_clock::now();
+    double lookup_time = chrono::duration_cast<chrono::duration<double>>(lookup_end - lookup_start).count();
+    TreeMemory_t memory = tree_memory(tree);
+    cout << "Node size: " << sizeof(RedBlackNode<int>) << " bytes, bytes per key: " << fixed << setprecision(2)
+         << memory.bytes_per_key << '\n';
+    cout << "Lookups/sec: " << scientific << setprecision(4) << num_operations / lookup_time << " ("
+         << found << " found)\n";
+
+    // Same lookups as one batch walked down the tree in lockstep
+    vector<bool> results;
+    const auto batch_start = chrono::steady_clock::now();
+    size_t batch_found = tree_lookup_batch(tree, lookups, results);
+    const auto batch_end = chrono::steady_clock::now();
+    double batch_time = chrono::duration_cast<chrono::duration<double>>(batch_end - batch_start).count();
+    cout << "Batch lookups/sec: " << scientific << setprecision(4) << num_operations / batch_time << '\n';
+    if (batch_found != found) {
+      cout << "Batch lookup found " << batch_found << " keys.\n";
+      return 1;
+    }
+
+    // Same lookups on a frozen copy of the tree
+    auto frozen = tree_freeze(tree);
+    size_t frozen_found = 0;
+    const auto frozen_start = chrono::steady_clock::now();
+    for (int key : lookups) {
+      frozen_found += frozen_lookup(frozen, key);
+    }
+    const auto frozen_end = chrono::steady_clock::now();
+    double frozen_time = chrono::duration_cast<chrono::duration<double>>(frozen_end - frozen_start).count();
+    cout << "Frozen bytes per key: " << fixed << setprecision(2) << (double)frozen_bytes(frozen) / keys.size()
+         << ", frozen lookups/sec: " << scientific << setprecision(4) << num_operations / frozen_time << '\n';
+
+    // And all of them as one batch
+    const auto frozen_batch_start = chrono::steady_clock::now();
+    size_t frozen_batch_found = frozen_lookup_batch(frozen, lookups, results);
+    const auto frozen_batch_end = chrono::steady_clock::now();
+    double frozen_batch_time =
+        chrono::duration_cast<chrono::duration<double>>(frozen_batch_end - frozen_batch_start).count();
+    cout << "Frozen batch lookups/sec: " << scientific << setprecision(4) << num_operations / frozen_batch_time
+         << '\n';
+    frozen_free(frozen);
+    if (frozen_found != found || frozen_batch_found != found) {
+      cout << "Frozen tree found " << frozen_found << " keys, " << frozen_batch_found << " in a batch.\n";
+      return 1;
+    }
+    if (!tree_validate(tree)) {
+      cout << "Produced invalid Tree.\n";
+      return 1;
+    }
+    tree_free(tree);
+    printf("Success.\n");
+    return 0;
+  }
+
   vector<Operation_t> operations;
   if (insert_test) {
     operations.resize(num_operations);
@@ -104,8 +187,9 @@ int main(int argc, char *argv[]) {
   }
 
   // Start Red-Black Testing Code Here
+  // The int set keeps subtree sizes (which tree_validate checks), the map below doesn't
   int expected_size = 0;
-  Tree tree = tree_init();
+  Tree tree = tree_init(use_node_pool, true);
   for (auto& operation : operations) {
     switch(operation.type) {
       case INSERT:
@@ -131,6 +215,119 @@ int main(int argc, char *argv[]) {
       return 1;
     }
   }
+  if (tree_memory(tree).nodes != (size_t)expected_size) {
+    cout << "Memory accounting reports the wrong number of nodes.\n";
+    return 1;
+  }
+
+  // Building a tree straight from the final keys in sorted order gives the same keys
+  vector<int> keys = tree_to_vector(tree);
+  Tree rebuilt = tree_init(use_node_pool);
+  if (!tree_build_from_sorted(rebuilt, keys) || !tree_validate(rebuilt) || tree_to_vector(rebuilt) != keys) {
+    cout << "Produced invalid tree from sorted keys.\n";
+    return 1;
+  }
+  tree_free(rebuilt);
+
+  // Walking the tree both ways and scanning a range of it visit the keys in order
+  vector<int> forward, backward, scanned;
+  for (TreeNode node = tree_successor(tree, nullptr); node; node = tree_successor(tree, node)) {
+    forward.push_back(node->key);
+  }
+  for (TreeNode node = tree_predecessor(tree, nullptr); node; node = tree_predecessor(tree, node)) {
+    backward.push_back(node->key);
+  }
+  reverse(backward.begin(), backward.end());
+  size_t lo = keys.size() / 4, hi = keys.size() - keys.size() / 4;
+  if (lo < hi) {
+    tree_range(tree, keys[lo], keys[hi - 1], [&](int key, NoValue) { scanned.push_back(key); });
+  }
+  if (forward != keys || backward != keys || scanned != vector<int>(keys.begin() + lo, keys.begin() + hi) ||
+      (lo < hi && tree_upper_bound(tree, keys[lo]) != tree_lower_bound(tree, keys[lo] + 1))) {
+    cout << "Iterated over the tree in the wrong order.\n";
+    return 1;
+  }
+
+  // A frozen copy finds every key and nothing in between, one at a time or in a batch
+  auto frozen = tree_freeze(tree);
+  vector<int> probes;
+  for (int key : keys) {
+    if (!frozen_lookup(frozen, key) || frozen_lookup(frozen, key + 1) != tree_lookup(tree, key + 1) ||
+        frozen_lookup(frozen, key - 1) != tree_lookup(tree, key - 1)) {
+      cout << "Frozen tree disagrees with the tree at " << key << ".\n";
+      return 1;
+    }
+    probes.insert(probes.end(), {key - 1, key, key + 1});
+  }
+  probes.insert(probes.end(), {INT_MIN, INT_MAX});
+  vector<bool> results, tree_results;
+  frozen_lookup_batch(frozen, probes, results);
+  tree_lookup_batch(tree, probes, tree_results);
+  for (size_t i = 0; i < probes.size(); i++) {
+    if (results[i] != tree_lookup(tree, probes[i]) || tree_results[i] != results[i]) {
+      cout << "Batch lookup disagrees with the tree at " << probes[i] << ".\n";
+      return 1;
+    }
+  }
+  frozen_free(frozen);
+
+  // Every key's rank is its index in sorted order
+  for (size_t i = 0; i < keys.size(); i++) {
+    int selected;
+    if (tree_rank(tree, keys[i]) != i || !tree_select(tree, i, selected) || selected != keys[i] ||
+        tree_count_range(tree, keys[i], keys.back()) != keys.size() - i) {
+      cout << "Produced wrong order statistics for " << keys[i] << ".\n";
+      return 1;
+    }
+  }
+  tree_free(tree);
+
+  // Same operations on the generic tree used as a map from string keys, whose
+  // values are flipped in place on every lookup
+  auto map = tree_init<string, int>(use_node_pool);
+  for (auto& operation : operations) {
+    string key = to_string(operation.val);
+    int value = 0;
+    switch(operation.type) {
+      case INSERT:
+        tree_insert(map, key, operation.val);
+        break;
+      case DELETE:
+        tree_delete(map, key);
+        break;
+      case LOOKUP:
+        if (!tree_find(map, key, value) || abs(value) != operation.val) {
+          cout << "Map returned the wrong value at operation " << operation_to_string(operation) << ".\n";
+          return 1;
+        }
+        tree_update(map, key, -value);
+        break;
+    }
+  }
+  if (!tree_validate(map) || tree_size(map) != expected_size) {
+    cout << "Produced invalid map.\n";
+    return 1;
+  }
+  auto frozen_map = tree_freeze(map);
+  vector<string> map_keys;
+  for (auto& operation : operations) {
+    string key = to_string(operation.val);
+    int value = 0, frozen_value = 0;
+    if (tree_find(map, key, value) != frozen_find(frozen_map, key, frozen_value) || value != frozen_value) {
+      cout << "Frozen map returned the wrong value for " << key << ".\n";
+      return 1;
+    }
+    map_keys.push_back(key);
+  }
+  frozen_lookup_batch(frozen_map, map_keys, results);
+  for (size_t i = 0; i < map_keys.size(); i++) {
+    if (results[i] != tree_lookup(map, map_keys[i])) {
+      cout << "Frozen map batch lookup disagrees with the map at " << map_keys[i] << ".\n";
+      return 1;
+    }
+  }
+  frozen_free(frozen_map);
+  tree_free(map);
   printf("Success.\n");
   return 0;
 }
\ No newline at end of file
@@ -1,5 +1,12 @@
+#ifndef RED_BLACK_SEQUENTIAL_H
+#define RED_BLACK_SEQUENTIAL_H
+
 #include <vector>
 #include <string>
+#include <functional>
+#include "node-pool.h"
+#include "tree-common.h"
+#include "frozen-tree.h"
 
 using namespace std;
 
@@ -7,33 +14,118 @@ using namespace std;
 #define DELETE 1
 #define LOOKUP 2
 
-typedef struct RedBlackNode {
-  struct RedBlackNode* child[2];
-  struct RedBlackNode* parent;
-  int val;
+// Built with NO_PARENT_POINTERS, nodes have no parent pointer and inserts and
+// deletes rebalance top-down in a single pass instead (red-black-top-down-impl.h)
+template <typename Key, typename Value = NoValue>
+struct RedBlackNode {
+  RedBlackNode* child[2];
+#ifndef NO_PARENT_POINTERS
+  RedBlackNode* parent = nullptr;
+#endif
+  Key key;
+  [[no_unique_address]] Value value;
+#ifdef COMPACT_NODES
+  // Color and subtree size share a word, which takes int-keyed nodes from 40
+  // bytes down to 32 (a pool then fits two of them in a cache line)
+  bool red : 1;
+  int size : 31;
+#else
   bool red;
-} *TreeNode;
+  // Number of keys in the subtree rooted here, kept only with order statistics
+  int size;
+#endif
+};
+
+template <typename Key, typename Value = NoValue, typename Compare = less<Key>>
+struct RedBlackTree {
+  typedef RedBlackNode<Key, Value> *Node;
+
+  Node root;
+  // Where nodes come from, null for plain new/delete
+  NodePool_t pool;
+  // Whether nodes keep their subtree sizes, for tree_rank and tree_select
+  bool order_statistics;
+  [[no_unique_address]] Compare compare;
+};
 
-typedef struct RedBlackTree {
-  TreeNode root;
-} *Tree;
+// The int set the drivers and benchmarks use
+typedef RedBlackTree<int> *Tree;
+typedef RedBlackNode<int> *TreeNode;
+
+// Memory held by a tree, see tree_memory
+typedef struct TreeMemory {
+  size_t nodes;
+  // Bytes allocated for the tree and its nodes (or its node pool's slabs)
+  size_t bytes;
+  double bytes_per_key;
+} TreeMemory_t;
 
 // Tree Functions
-Tree tree_init();
-bool tree_insert(Tree &tree, int val);
-bool tree_delete(Tree &tree, int val);
-bool tree_lookup(Tree &tree, int val);
+template <typename Key = int, typename Value = NoValue, typename Compare = less<Key>>
+RedBlackTree<Key, Value, Compare> *tree_init(bool use_node_pool = false, bool order_statistics = false,
+                                             Compare compare = Compare());
+template <typename Key, typename Value, typename Compare>
+void tree_free(RedBlackTree<Key, Value, Compare> *&tree);
+template <typename Key, typename Value, typename Compare>
+TreeMemory_t tree_memory(RedBlackTree<Key, Value, Compare> *&tree);
+template <typename Key, typename Value, typename Compare>
+bool tree_insert(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Arg<Value> value = Value());
+template <typename Key, typename Value, typename Compare>
+bool tree_delete(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key);
+template <typename Key, typename Value, typename Compare>
+bool tree_lookup(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key);
+template <typename Key, typename Value, typename Compare>
+size_t tree_lookup_batch(RedBlackTree<Key, Value, Compare> *&tree, const vector<Key> &keys, vector<bool> &results);
+template <typename Key, typename Value, typename Compare>
+bool tree_find(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Value &value);
+template <typename Key, typename Value, typename Compare>
+bool tree_update(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Arg<Value> value);
+template <typename Key, typename Value, typename Compare, typename Callback>
+size_t tree_range(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> lo, Arg<Key> hi, Callback callback);
+template <typename Key, typename Value, typename Compare>
+typename RedBlackTree<Key, Value, Compare>::Node tree_lower_bound(RedBlackTree<Key, Value, Compare> *&tree,
+                                                                  Arg<Key> key);
+template <typename Key, typename Value, typename Compare>
+typename RedBlackTree<Key, Value, Compare>::Node tree_upper_bound(RedBlackTree<Key, Value, Compare> *&tree,
+                                                                  Arg<Key> key);
+template <typename Key, typename Value, typename Compare>
+typename RedBlackTree<Key, Value, Compare>::Node tree_successor(RedBlackTree<Key, Value, Compare> *&tree,
+                                                                typename RedBlackTree<Key, Value, Compare>::Node node);
+template <typename Key, typename Value, typename Compare>
+typename RedBlackTree<Key, Value, Compare>::Node tree_predecessor(RedBlackTree<Key, Value, Compare> *&tree,
+                                                                  typename RedBlackTree<Key, Value, Compare>::Node node);
+template <typename Key, typename Value, typename Compare>
+size_t tree_rank(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key);
+template <typename Key, typename Value, typename Compare>
+bool tree_select(RedBlackTree<Key, Value, Compare> *&tree, size_t rank, Key &key);
+template <typename Key, typename Value, typename Compare>
+size_t tree_count_range(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> lo, Arg<Key> hi);
+template <typename Key, typename Value, typename Compare>
+bool tree_build_from_sorted(RedBlackTree<Key, Value, Compare> *&tree, const vector<Key> &keys,
+                            const vector<Value> &values = {});
+template <typename Key, typename Value, typename Compare>
+FrozenTree<Key, Value, Compare> *tree_freeze(RedBlackTree<Key, Value, Compare> *&tree);
 
 // Debug Functions
-int tree_size(Tree &tree);
-bool tree_validate(Tree &tree);
-string tree_to_string(Tree tree);
-vector <int> tree_to_vector(Tree &tree);
+template <typename Key, typename Value, typename Compare>
+int tree_size(RedBlackTree<Key, Value, Compare> *&tree);
+template <typename Key, typename Value, typename Compare>
+bool tree_validate(RedBlackTree<Key, Value, Compare> *&tree);
+template <typename Key, typename Value, typename Compare>
+string tree_to_string(RedBlackTree<Key, Value, Compare> *tree);
+template <typename Key, typename Value, typename Compare>
+vector <Key> tree_to_vector(RedBlackTree<Key, Value, Compare> *&tree);
 
 typedef struct Operation {
     int type;
-    int val; 
+    int val;
 } Operation_t;
 
 // Helper functions
-string operation_to_string(Operation_t operation);
\ No newline at end of file
+string operation_to_string(Operation_t operation);
+
+// Template definitions
+#include "red-black-sequential-impl.h"
+#include "red-black-top-down-impl.h"
+
+#endif
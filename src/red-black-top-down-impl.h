@@ -0,0 +1,227 @@
+#ifdef NO_PARENT_POINTERS
+
+using namespace std;
+
+// Without parent pointers nothing can walk back up the tree, so inserts and
+// deletes rebalance on the way down in a single pass, the same way the lock-free
+// tree does. The few nodes above the current one that a rotation has to relink
+// are kept on a path stack (insert) or in locals (delete).
+// Source: https://eternallyconfuzzled.com/red-black-trees-c-the-most-common-balanced-binary-search-tree
+
+// Empty children count as black
+template <typename Key, typename Value>
+inline bool is_red(RedBlackNode<Key, Value> *node) {
+  return node && node->red;
+}
+
+// Makes replacement the child of parent that child was (the root if parent is null)
+template <typename Key, typename Value, typename Compare>
+inline void replace_child(RedBlackTree<Key, Value, Compare> *&tree, RedBlackNode<Key, Value> *parent,
+                          RedBlackNode<Key, Value> *child, RedBlackNode<Key, Value> *replacement) {
+  if (parent) {
+    parent->child[parent->child[1] == child] = replacement;
+  } else {
+    tree->root = replacement;
+  }
+}
+
+// Rotates the subtree at root (a child of parent, or the tree's root if parent
+// is null) in direction dir, returns the node that took its place
+template <typename Key, typename Value, typename Compare>
+RedBlackNode<Key, Value> *rotateDir(RedBlackTree<Key, Value, Compare> *&tree, RedBlackNode<Key, Value> *parent,
+                                    RedBlackNode<Key, Value> *root, int dir) {
+  RedBlackNode<Key, Value> *rotatingChild = root->child[1-dir];
+  RedBlackNode<Key, Value> *C = rotatingChild->child[dir];
+  root->child[1-dir] = C;
+  rotatingChild->child[dir] = root;
+  replace_child(tree, parent, root, rotatingChild);
+
+  // The rising child takes over the whole subtree, root gives up the part that
+  // stayed with the rising child. Written as a difference rather than summed up
+  // from the children, since root has already counted the key being inserted or
+  // deleted when its children may not have yet.
+  if (tree->order_statistics) {
+    int root_size = root->size;
+    root->size = root_size - rotatingChild->size + node_size(C);
+    rotatingChild->size = root_size;
+  }
+  return rotatingChild;
+}
+
+// Inserts key (with value) into Tree, returns true if key wasn't already present
+// (an existing key keeps its value)
+template <typename Key, typename Value, typename Compare>
+bool tree_insert(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key, Arg<Value> value) {
+  typedef RedBlackNode<Key, Value> *Node;
+  // Reused across calls so inserting doesn't allocate anything but the new node
+  static thread_local vector<Node> path;
+
+  // Edge Case: Set root of Empty tree
+  if (!tree->root) {
+    tree->root = newTreeNode(tree, key, value, false, nullptr, nullptr, nullptr);
+    return true;
+  }
+  // Sizes are counted on the way down, so a key already present has to be
+  // turned away first
+  if (tree->order_statistics && lookup_node(tree, key)) {
+    return false;
+  }
+
+  // Search path from above the root (null) down to the current node
+  path.assign({nullptr, tree->root});
+  if (tree->order_statistics) tree->root->size++;
+  bool inserted = false;
+
+  while (true) {
+    Node node = path.back();
+
+    // Node has two red children, swap colors with them
+    Node left = node->child[0], right = node->child[1];
+    if (is_red(left) && is_red(right)) {
+      node->red = true;
+      left->red = false;
+      right->red = false;
+      // Root always stays black
+      if (path.size() == 2) {
+        node->red = false;
+      }
+    }
+
+    // Node and parent both red, rotate at the grandparent
+    // (a red parent is never the root, so the grandparent exists)
+    size_t depth = path.size();
+    if (depth >= 4 && node->red && path[depth - 2]->red) {
+      Node parent = path[depth - 2];
+      Node grandparent = path[depth - 3];
+      int dir = parent == grandparent->child[1];
+      if (node == parent->child[dir]) {
+        // Node is an outer child, a single rotation lifts parent above grandparent
+        rotateDir(tree, path[depth - 4], grandparent, 1-dir);
+        parent->red = false;
+        grandparent->red = true;
+        path.erase(path.end() - 3);
+      } else {
+        // Node is an inner child, a double rotation lifts node above both
+        rotateDir(tree, grandparent, parent, dir);
+        rotateDir(tree, path[depth - 4], grandparent, 1-dir);
+        node->red = false;
+        grandparent->red = true;
+        path.erase(path.end() - 3, path.end() - 1);
+      }
+    }
+
+    // Either the key was already present or we just fixed up the new node
+    bool equal;
+    int dir = key_direction(tree, key, node->key, equal);
+    if (equal) {
+      break;
+    }
+
+    // Step down, creating the new node if we fell off the tree
+    Node next = node->child[dir];
+    if (!next) {
+      next = newTreeNode(tree, key, value, true, node, nullptr, nullptr);
+      node->child[dir] = next;
+      inserted = true;
+    } else if (tree->order_statistics) {
+      next->size++;
+    }
+    path.push_back(next);
+  }
+  return inserted;
+}
+
+// Deletes key from the Tree, returns true if key was present in the tree
+template <typename Key, typename Value, typename Compare>
+bool tree_delete(RedBlackTree<Key, Value, Compare> *&tree, Arg<Key> key) {
+  typedef RedBlackNode<Key, Value> *Node;
+  // Don't delete from an empty tree, and with sizes counted on the way down
+  // not a key that isn't there either
+  if (!tree->root || (tree->order_statistics && !lookup_node(tree, key))) {
+    return false;
+  }
+
+  // A null grandparent or parent stands for above the root
+  Node grandparent = nullptr, parent = nullptr, node = tree->root;
+  // Node holding key, which takes over its predecessor's key and value
+  Node found = nullptr;
+  int last = 1;
+  // Every node on the way down to the node finally unlinked no longer counts it
+  if (tree->order_statistics) node->size--;
+
+  while (true) {
+    // Once key is found, keep going left then right to its in-order predecessor
+    bool equal;
+    int dir = key_direction(tree, key, node->key, equal);
+    if (equal) {
+      found = node;
+    }
+
+    // Push the red node down
+    if (!is_red(node) && !is_red(node->child[dir])) {
+      if (is_red(node->child[1-dir])) {
+        // Red child on the far side, rotate it above node
+        Node red_child = rotateDir(tree, parent, node, dir);
+        node->red = true;
+        red_child->red = false;
+        parent = red_child;
+      } else if (parent) {
+        Node sibling = parent->child[1-last];
+        if (sibling) {
+          Node close_nephew = sibling->child[last];
+          Node distant_nephew = sibling->child[1-last];
+          if (!is_red(close_nephew) && !is_red(distant_nephew)) {
+            // Both nephews black, swap colors with parent
+            parent->red = false;
+            sibling->red = true;
+            node->red = true;
+          } else {
+            // A red nephew, rotate it (or the sibling) above parent
+            if (is_red(close_nephew)) {
+              rotateDir(tree, parent, sibling, 1-last);
+            }
+            Node top = rotateDir(tree, grandparent, parent, last);
+            node->red = true;
+            top->red = true;
+            top->child[0]->red = false;
+            top->child[1]->red = false;
+            // Root always stays black
+            if (!grandparent) {
+              top->red = false;
+            }
+          }
+        }
+      }
+    }
+
+    Node next = node->child[dir];
+    if (!next) {
+      break;
+    }
+
+    // Step down
+    grandparent = parent;
+    parent = node;
+    node = next;
+    last = dir;
+    if (tree->order_statistics) node->size--;
+  }
+
+  if (!found) {
+    return false;
+  }
+
+  // Unlink the predecessor (now red, or the root) which has at most one child,
+  // after handing its key and value to the node being deleted
+  Node child = node->child[node->child[0] == nullptr];
+  replace_child(tree, parent, node, child);
+  if (child && !parent) child->red = false;
+  if (found != node) {
+    found->key = std::move(node->key);
+    found->value = std::move(node->value);
+  }
+  freeTreeNode(tree, node);
+  return true;
+}
+
+#endif
@@ -5,6 +5,10 @@ test_cases = os.listdir(f"./inputs")
 test_modes = ["basic", "bulk", "random"]
 concurrency_mode = "parallel"
 
+# Pin OpenMP's threads one per core, as exp.sh does
+os.environ.setdefault("OMP_PROC_BIND", "close")
+os.environ.setdefault("OMP_PLACES", "cores")
+
 # For PSC:
 # all_num_threads = [1, 2, 4, 8, 16, 32, 64, 128]
 
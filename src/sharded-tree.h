@@ -0,0 +1,306 @@
+#ifndef SHARDED_TREE_H
+#define SHARDED_TREE_H
+
+#include <vector>
+#include <span>
+#include <mutex>
+#include <algorithm>
+#include <functional>
+#include <omp.h>
+#include "node-pool.h"
+
+using namespace std;
+
+/******************************************************************************/
+/*                            SHARDED TREES                                   */
+/******************************************************************************/
+/*   K independent trees (shards) splitting the key space into K ranges, so   */
+/*   writers to different ranges never touch the same root. Works over either */
+/*   tree: include this after red-black-sequential.h or red-black-lock-free.h */
+/*   and make a ShardedTree of its tree pointer type. Sequential shards are    */
+/*   made locked, every operation on one then holding its mutex.              */
+/*                                                                            */
+/*   The bulk operations partition their keys by shard first (a parallel       */
+/*   counting sort, each thread histogramming and scattering its own slice),  */
+/*   then hand out whole shards to threads, so each shard's keys are applied  */
+/*   by one thread with nobody else in that tree. That needs at least as many */
+/*   shards as threads, and a few times more to even out uneven shards.       */
+/*   Shards hold consecutive key ranges, so scans just visit them in order.   */
+/******************************************************************************/
+
+// Key type and key order of a shard, from its tree pointer type
+template <typename Shard>
+struct ShardTraits;
+template <template <typename, typename, typename> class Tree, typename Key, typename Value, typename Compare>
+struct ShardTraits<Tree<Key, Value, Compare> *> {
+  typedef Key KeyType;
+  typedef Compare CompareType;
+};
+
+// A shard's mutex, on a cache line of its own
+struct alignas(CACHE_LINE_SIZE) ShardLock {
+  mutex lock;
+};
+
+template <typename Shard>
+struct ShardedTree {
+  typedef typename ShardTraits<Shard>::KeyType Key;
+  typedef typename ShardTraits<Shard>::CompareType Compare;
+
+  vector<Shard> shards;
+  // Shard s holds the keys in [splitters[s - 1], splitters[s]), the first
+  // shard everything below splitters[0] and the last everything from the last
+  // splitter up. Non-decreasing under compare, one fewer than the shards.
+  vector<Key> splitters;
+  // The shards' key order, which the splitters follow too
+  [[no_unique_address]] Compare compare;
+  // Whether each operation on a shard takes its lock, for shards that can't be
+  // used by several threads at once
+  bool locked;
+  vector<ShardLock> locks;
+};
+
+// Sharded Tree Functions
+template <typename Shard, typename Make>
+ShardedTree<Shard> *sharded_init(const vector<typename ShardedTree<Shard>::Key> &splitters, bool locked,
+                                 Make make_shard);
+template <typename Shard>
+void sharded_free(ShardedTree<Shard> *&sharded);
+template <typename Key, typename Compare = less<Key>>
+vector<Key> sharded_splitters(vector<Key> sample, int num_shards, Compare compare = Compare());
+template <typename Shard>
+int sharded_shard_of(ShardedTree<Shard> *sharded, const typename ShardedTree<Shard>::Key &key);
+template <typename Shard>
+bool sharded_insert(ShardedTree<Shard> *sharded, const typename ShardedTree<Shard>::Key &key);
+template <typename Shard>
+bool sharded_delete(ShardedTree<Shard> *sharded, const typename ShardedTree<Shard>::Key &key);
+template <typename Shard>
+bool sharded_lookup(ShardedTree<Shard> *sharded, const typename ShardedTree<Shard>::Key &key);
+template <typename Shard>
+size_t sharded_insert_bulk(ShardedTree<Shard> *sharded, span<const typename ShardedTree<Shard>::Key> keys,
+                           int num_threads);
+template <typename Shard>
+size_t sharded_delete_bulk(ShardedTree<Shard> *sharded, span<const typename ShardedTree<Shard>::Key> keys,
+                           int num_threads);
+template <typename Shard>
+size_t sharded_lookup_bulk(ShardedTree<Shard> *sharded, span<const typename ShardedTree<Shard>::Key> keys,
+                           int num_threads);
+template <typename Shard, typename Callback>
+size_t sharded_range(ShardedTree<Shard> *sharded, const typename ShardedTree<Shard>::Key &lo,
+                     const typename ShardedTree<Shard>::Key &hi, Callback callback);
+template <typename Shard>
+size_t sharded_size(ShardedTree<Shard> *sharded);
+template <typename Shard>
+bool sharded_validate(ShardedTree<Shard> *sharded);
+
+/******************************************************************************/
+/*                             DEFINITIONS                                    */
+/******************************************************************************/
+
+// Makes a sharded tree with one shard more than splitters, each from make_shard()
+template <typename Shard, typename Make>
+ShardedTree<Shard> *sharded_init(const vector<typename ShardedTree<Shard>::Key> &splitters, bool locked,
+                                 Make make_shard) {
+  ShardedTree<Shard> *sharded = new ShardedTree<Shard>();
+  sharded->splitters = splitters;
+  sharded->locked = locked;
+  sharded->locks = vector<ShardLock>(splitters.size() + 1);
+  for (size_t s = 0; s <= splitters.size(); s++) {
+    sharded->shards.push_back(make_shard());
+  }
+  sharded->compare = sharded->shards[0]->compare;
+  return sharded;
+}
+
+template <typename Shard>
+void sharded_free(ShardedTree<Shard> *&sharded) {
+  for (Shard &shard : sharded->shards) {
+    tree_free(shard);
+  }
+  delete sharded;
+  sharded = nullptr;
+}
+
+// Splitters for num_shards shards holding about as many of the sample's keys
+// each, for shards ordering keys by compare
+template <typename Key, typename Compare>
+vector<Key> sharded_splitters(vector<Key> sample, int num_shards, Compare compare) {
+  sort(sample.begin(), sample.end(), compare);
+  vector<Key> splitters;
+  if (sample.empty()) return splitters;
+  for (int s = 1; s < num_shards; s++) {
+    splitters.push_back(sample[sample.size() * s / num_shards]);
+  }
+  return splitters;
+}
+
+// Returns the shard key belongs in
+template <typename Shard>
+int sharded_shard_of(ShardedTree<Shard> *sharded, const typename ShardedTree<Shard>::Key &key) {
+  return upper_bound(sharded->splitters.begin(), sharded->splitters.end(), key, sharded->compare) -
+         sharded->splitters.begin();
+}
+
+// Runs fn(shard) holding the shard's lock, if the shards are locked
+template <typename Shard, typename Function>
+auto with_shard(ShardedTree<Shard> *sharded, int s, Function fn) {
+  if (!sharded->locked) return fn(sharded->shards[s]);
+  lock_guard<mutex> guard(sharded->locks[s].lock);
+  return fn(sharded->shards[s]);
+}
+
+template <typename Shard>
+bool sharded_insert(ShardedTree<Shard> *sharded, const typename ShardedTree<Shard>::Key &key) {
+  return with_shard(sharded, sharded_shard_of(sharded, key), [&](Shard &shard) { return tree_insert(shard, key); });
+}
+
+template <typename Shard>
+bool sharded_delete(ShardedTree<Shard> *sharded, const typename ShardedTree<Shard>::Key &key) {
+  return with_shard(sharded, sharded_shard_of(sharded, key), [&](Shard &shard) { return tree_delete(shard, key); });
+}
+
+template <typename Shard>
+bool sharded_lookup(ShardedTree<Shard> *sharded, const typename ShardedTree<Shard>::Key &key) {
+  return with_shard(sharded, sharded_shard_of(sharded, key), [&](Shard &shard) { return tree_lookup(shard, key); });
+}
+
+// Groups keys by shard into partitioned, shard s's keys (in their order in
+// keys) starting at starts[s], and starts[num_shards] at the end
+template <typename Shard>
+void partition_by_shard(ShardedTree<Shard> *sharded, span<const typename ShardedTree<Shard>::Key> keys,
+                        vector<typename ShardedTree<Shard>::Key> &partitioned, vector<size_t> &starts,
+                        int num_threads) {
+  size_t num_keys = keys.size();
+  int num_shards = sharded->shards.size();
+  int threads_needed = max<size_t>(1, min<size_t>(num_keys, num_threads));
+  partitioned.resize(num_keys);
+  starts.assign(num_shards + 1, 0);
+  // Where each thread's keys for each shard go, counts first
+  vector<size_t> offsets((size_t)threads_needed * num_shards, 0);
+  vector<int> owners(num_keys);
+
+  #pragma omp parallel num_threads(threads_needed)
+  {
+    int thread = omp_get_thread_num();
+    size_t lo = num_keys * thread / threads_needed, hi = num_keys * (thread + 1) / threads_needed;
+    size_t *offset = &offsets[(size_t)thread * num_shards];
+    for (size_t i = lo; i < hi; i++) {
+      owners[i] = sharded_shard_of(sharded, keys[i]);
+      offset[owners[i]]++;
+    }
+
+    // Shard by shard, thread by thread, so each shard's keys stay in order
+    #pragma omp barrier
+    #pragma omp single
+    {
+      size_t total = 0;
+      for (int s = 0; s < num_shards; s++) {
+        starts[s] = total;
+        for (int t = 0; t < threads_needed; t++) {
+          size_t count = offsets[(size_t)t * num_shards + s];
+          offsets[(size_t)t * num_shards + s] = total;
+          total += count;
+        }
+      }
+      starts[num_shards] = total;
+    }
+
+    for (size_t i = lo; i < hi; i++) {
+      partitioned[offset[owners[i]]++] = keys[i];
+    }
+  }
+}
+
+// Partitions keys by shard and calls apply(shard, key) for each, one thread per
+// shard at a time, returns how many calls returned true
+template <typename Shard, typename Apply>
+size_t apply_by_shard(ShardedTree<Shard> *sharded, span<const typename ShardedTree<Shard>::Key> keys,
+                      int num_threads, Apply apply) {
+  // Reused across calls, so batches don't allocate once warmed up
+  static thread_local vector<typename ShardedTree<Shard>::Key> partitioned;
+  static thread_local vector<size_t> starts;
+  partition_by_shard(sharded, keys, partitioned, starts, num_threads);
+
+  int num_shards = sharded->shards.size();
+  size_t succeeded = 0;
+  auto &shard_keys = partitioned;
+  auto &shard_starts = starts;
+  int threads_needed = max(1, min(num_shards, num_threads));
+  #pragma omp parallel for schedule(dynamic, 1) num_threads(threads_needed) reduction(+:succeeded)
+  for (int s = 0; s < num_shards; s++) {
+    if (shard_starts[s] == shard_starts[s + 1]) continue;
+    succeeded += with_shard(sharded, s, [&](Shard &shard) {
+      size_t applied = 0;
+      for (size_t i = shard_starts[s]; i < shard_starts[s + 1]; i++) {
+        applied += apply(shard, shard_keys[i]);
+      }
+      return applied;
+    });
+  }
+  return succeeded;
+}
+
+// Inserts keys with num_threads threads, returns how many weren't in the tree yet
+template <typename Shard>
+size_t sharded_insert_bulk(ShardedTree<Shard> *sharded, span<const typename ShardedTree<Shard>::Key> keys,
+                           int num_threads) {
+  typedef typename ShardedTree<Shard>::Key Key;
+  auto apply = [](Shard &shard, const Key &key) { return tree_insert(shard, key); };
+  return apply_by_shard(sharded, keys, num_threads, apply);
+}
+
+// Deletes keys with num_threads threads, returns how many were in the tree
+template <typename Shard>
+size_t sharded_delete_bulk(ShardedTree<Shard> *sharded, span<const typename ShardedTree<Shard>::Key> keys,
+                           int num_threads) {
+  typedef typename ShardedTree<Shard>::Key Key;
+  auto apply = [](Shard &shard, const Key &key) { return tree_delete(shard, key); };
+  return apply_by_shard(sharded, keys, num_threads, apply);
+}
+
+// Looks up keys with num_threads threads, returns how many were found
+template <typename Shard>
+size_t sharded_lookup_bulk(ShardedTree<Shard> *sharded, span<const typename ShardedTree<Shard>::Key> keys,
+                           int num_threads) {
+  typedef typename ShardedTree<Shard>::Key Key;
+  auto apply = [](Shard &shard, const Key &key) { return tree_lookup(shard, key); };
+  return apply_by_shard(sharded, keys, num_threads, apply);
+}
+
+// Calls callback(key, value) for every key in [lo, hi] in ascending order, as
+// tree_range does on each shard in turn, returns how many keys it was called for
+template <typename Shard, typename Callback>
+size_t sharded_range(ShardedTree<Shard> *sharded, const typename ShardedTree<Shard>::Key &lo,
+                     const typename ShardedTree<Shard>::Key &hi, Callback callback) {
+  size_t visited = 0;
+  for (int s = sharded_shard_of(sharded, lo), last = sharded_shard_of(sharded, hi); s <= last; s++) {
+    visited += with_shard(sharded, s, [&](Shard &shard) { return tree_range(shard, lo, hi, callback); });
+  }
+  return visited;
+}
+
+template <typename Shard>
+size_t sharded_size(ShardedTree<Shard> *sharded) {
+  size_t size = 0;
+  for (int s = 0; s < (int)sharded->shards.size(); s++) {
+    size += with_shard(sharded, s, [](Shard &shard) { return tree_size(shard); });
+  }
+  return size;
+}
+
+// Returns whether every shard is a valid tree holding only keys in its range
+template <typename Shard>
+bool sharded_validate(ShardedTree<Shard> *sharded) {
+  for (int s = 0; s < (int)sharded->shards.size(); s++) {
+    bool valid = with_shard(sharded, s, [&](Shard &shard) {
+      if (!tree_validate(shard)) return false;
+      auto keys = tree_to_vector(shard);
+      return keys.empty() ||
+             (sharded_shard_of(sharded, keys.front()) == s && sharded_shard_of(sharded, keys.back()) == s);
+    });
+    if (!valid) return false;
+  }
+  return true;
+}
+
+#endif
@@ -1,42 +1,61 @@
 import random
 import os
+import struct
+from array import array
 
 max_int, min_int = 2 ** 31 - 1, -2 ** 31
 operations = {
     "insert" : ["INSERT"],
     "both" : ["INSERT", "DELETE"]
 }
+# Operation type numbers and header of the binary format (see workload.h)
+op_types = {"INSERT": 0, "DELETE": 1, "LOOKUP": 2}
+WORKLOAD_MAGIC, WORKLOAD_VERSION = b"RBTWORK\0", 1
 
-def insert(f, op, num_ops, val_pool=None):
-    f.write(f"{op} {num_ops}\n")      
-    str_values = [str(random.randint(min_int, max_int)) for _ in range(num_ops)]
-    if val_pool is not None: val_pool.update(str_values)
-    f.write(" ".join(str_values) + "\n")
+def insert(runs, op, num_ops, val_pool=None):
+    values = [random.randint(min_int, max_int) for _ in range(num_ops)]
+    if val_pool is not None: val_pool.update(values)
+    runs.append((op, values))
 
-def generate_test_cases(fpath, num_ops=10, min_len=1, max_len=1000, optype="both"):
+def generate_test_cases(num_ops=10, min_len=1, max_len=1000, optype="both"):
+    runs = []
+    if optype == "insert":
+        for _ in range(num_ops):
+            op = random.choice(operations[optype])
+            num_ops = random.randint(min_len, max_len)
+            insert(runs, op, num_ops, val_pool=None)
+    elif optype == "both":
+        val_pool = set()
+        for _ in range(num_ops):
+            op = random.choice(operations["both"])
+            num_ops = random.randint(min_len, max_len)
+            if op == "INSERT":
+                insert(runs, op, num_ops, val_pool)
+            elif op == "DELETE":
+                prev_len = len(val_pool)
+                if prev_len == 0:
+                    insert(runs, "INSERT", num_ops, val_pool=None)
+                    continue
+                values = random.sample(list(val_pool), min(num_ops, prev_len))
+                val_pool.difference_update(values)
+                runs.append((op, values))
+    return runs
+
+def write_text(fpath, runs):
     with open(fpath, "w") as f:
-        if optype == "insert":
-            for _ in range(num_ops):
-                op = random.choice(operations[optype])
-                num_ops = random.randint(min_len, max_len)
-                insert(f, op, num_ops, val_pool=None)
-        elif optype == "both":
-            val_pool = set()
-            for _ in range(num_ops):
-                op = random.choice(operations["both"])
-                num_ops = random.randint(min_len, max_len)          
-                if op == "INSERT":
-                    insert(f, op, num_ops, val_pool)
-                elif op == "DELETE":
-                    prev_len = len(val_pool)                    
-                    if prev_len == 0:
-                        insert(f, "INSERT", num_ops, val_pool=None)
-                        continue
-                    str_values = random.sample(list(val_pool), min(num_ops, prev_len))
-                    val_pool.difference_update(str_values)
-                    f.write(f"{op} {len(str_values)}\n")      
-                    f.write(" ".join(str_values) + "\n")
-                    
+        for op, values in runs:
+            f.write(f"{op} {len(values)}\n")
+            f.write(" ".join(map(str, values)) + "\n")
+
+def write_binary(fpath, runs):
+    num_keys = sum(len(values) for _, values in runs)
+    with open(fpath, "wb") as f:
+        f.write(struct.pack("=8sIIQQ", WORKLOAD_MAGIC, WORKLOAD_VERSION, 4, len(runs), num_keys))
+        for op, values in runs:
+            f.write(struct.pack("=IIQ", op_types[op], 0, len(values)))
+        for _, values in runs:
+            array("i", values).tofile(f)
+
 filename = input("Enter the name of the file to write the test cases to: ")
 num_ops = input("Enter the number of operations to generate: ")
 if len(num_ops) == 0:
@@ -63,5 +82,15 @@ if user_op_input not in operations:
     print("Invalid operation type. Defaulting to both.")
     user_op_input = "both"
 
+output_format = input("Enter the output format (text, binary): ").strip().lower()
+
+if output_format not in ["text", "binary"]:
+    print("Invalid output format. Defaulting to text.")
+    output_format = "text"
+
 filepath = os.getcwd() + f"/inputs/{filename}"
-generate_test_cases(filepath, int(num_ops), int(min_len), int(max_len), user_op_input)
\ No newline at end of file
+runs = generate_test_cases(int(num_ops), int(min_len), int(max_len), user_op_input)
+if output_format == "binary":
+    write_binary(filepath, runs)
+else:
+    write_text(filepath, runs)
\ No newline at end of file
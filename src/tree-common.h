@@ -0,0 +1,47 @@
+#ifndef TREE_COMMON_H
+#define TREE_COMMON_H
+
+#include <string>
+#include <type_traits>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// Value type of trees used as plain sets of keys, takes up no space in a node
+struct NoValue {};
+
+// Keys and values that are cheap to copy (ints, pointers, small structs) are
+// passed by value, anything else (strings, large composite keys) by reference
+template <typename T>
+using Arg = typename conditional<is_trivially_copyable<T>::value && sizeof(T) <= 2 * sizeof(void *),
+                                 T, const T &>::type;
+
+// Lookups tree_lookup_batch walks down the tree together, enough for their
+// cache misses on each level to overlap
+#define LOOKUP_BATCH 16
+
+// Tells the core we're spinning, freeing its resources for a sibling thread
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// Printable form of a key for debug output, keys other than numbers and strings
+// print as "?"
+template <typename T>
+string key_to_string(const T &key) {
+  if constexpr (is_arithmetic<T>::value) {
+    return to_string(key);
+  } else if constexpr (is_convertible<T, string>::value) {
+    return string(key);
+  } else {
+    return "?";
+  }
+}
+
+#endif
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <iostream>
+
+using namespace std;
+
+// The following code was inspired and partially sourced from:
+// https://github.com/zhangshun97/Lock-free-Red-black-tree/
+
+/******************************************************************************/
+/*                                 HELPER FUNCTIONS                           */
+/******************************************************************************/
+/*   A thread's local area is the set of nodes whose flags it currently holds. */
+/*   Insert and delete both run top-down in a single pass, so the local area   */
+/*   is a small window (great-grandparent, grandparent, parent, node and the   */
+/*   children/sibling needed to read colors) that slides down the search path. */
+/*   A flag is only ever acquired on a child of a node already in the local    */
+/*   area, so threads only wait on nodes below them and can never deadlock.   */
+/*   The link above the root is guarded by the tree's head, a sentinel node   */
+/*   whose left child is the root, so the root needs no special case.        */
+/******************************************************************************/
+
+/******************************************************************************/
+/*   TREE_STAT(field, n) adds n to one of the calling thread's TreeStats when */
+/*   built with -DTREE_STATS, and compiles to nothing otherwise. Each thread  */
+/*   counts into its own cache-line padded record, so counting never         */
+/*   contends; tree_stats sums them up.                                       */
+/******************************************************************************/
+#ifdef TREE_STATS
+// The calling thread's counters
+inline TreeStats_t *tree_stats_record() {
+  static thread_local TreeStats_t *record = tree_stats_claim();
+  return record;
+}
+
+// Only the owner writes a counter, but tree_stats may read it meanwhile
+inline void tree_stat(uint64_t &counter, uint64_t n) {
+  atomic_ref<uint64_t>(counter).store(counter + n, memory_order_relaxed);
+}
+
+#define TREE_STAT(field, n) tree_stat(tree_stats_record()->field, (n))
+#else
+#define TREE_STAT(field, n) ((void)0)
+#endif
+
+// Counts an insert or delete that rebalanced at fixups levels
+inline void count_fixups(int fixups) {
+  TREE_STAT(fixup_depth[min(fixups, FIXUP_DEPTH_BUCKETS - 1)], 1);
+  (void)fixups;
+}
+
+// Waits before an optimistic read starts over because the tree changed underneath
+inline void restart_wait(Backoff_t &backoff) {
+  TREE_STAT(restarts, 1);
+  backoff_wait(backoff);
+}
+
+// Wait until the flag of node is ours
+template <typename Node>
+void flag_node(Node node) {
+  Backoff_t backoff = {0};
+  bool expected = false;
+  while (!node->flag.compare_exchange_weak(expected, true)) {
+    TREE_STAT(cas_failures, 1);
+    // Back off, and only try again once the flag looks free, so waiters read
+    // the flag's cache line instead of taking it away from the holder over and over
+    do {
+      backoff_wait(backoff);
+    } while (node->flag.load(memory_order_relaxed));
+    expected = false;
+  }
+}
+
+// Release the flag of node
+template <typename Node>
+void unflag_node(Node node) {
+  node->flag = false;
+}
+
+// Add node to the local area, unless this thread already holds its flag
+template <typename Node>
+void add_to_local_area(Node node, vector<Node> &flagged_nodes) {
+  for (auto &flagged_node : flagged_nodes) {
+    if (flagged_node == node) return;
+  }
+  flag_node(node);
+  flagged_nodes.push_back(node);
+}
+
+// Release every flag in the local area except the ones for nodes in keep
+template <typename Node>
+void shrink_local_area(vector<Node> &flagged_nodes, initializer_list<Node> keep) {
+  size_t kept = 0;
+  for (size_t i = 0; i < flagged_nodes.size(); i++) {
+    bool keep_node = false;
+    for (auto &node : keep) {
+      if (node == flagged_nodes[i]) {
+        keep_node = true;
+        break;
+      }
+    }
+    if (keep_node) {
+      flagged_nodes[kept++] = flagged_nodes[i];
+    } else {
+      unflag_node(flagged_nodes[i]);
+    }
+  }
+  flagged_nodes.resize(kept);
+}
+
+// Clear a thread's local area of flags
+template <typename Node>
+void clear_local_area(vector<Node> &flagged_nodes) {
+  for (auto &node : flagged_nodes) {
+    unflag_node(node);
+  }
+  flagged_nodes.clear();
+}
+
+/******************************************************************************/
+/*   tree_lookup takes no flags at all, instead every node carries a version  */
+/*   (a seqlock) which a writer makes odd while it changes the node's child   */
+/*   pointers (or its value). A lookup that sees a version change on a node   */
+/*   it passed through restarts, so it never follows a stale link into the    */
+/*   wrong subtree. The writer must hold the node's flag.                     */
+/******************************************************************************/
+
+// Mark node as being changed
+template <typename Node>
+void begin_modify(Node node) {
+  atomic<unsigned int> &version = node->version;
+  version.store(version.load(memory_order_relaxed) + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+// Mark node as consistent again
+template <typename Node>
+void end_modify(Node node) {
+  atomic<unsigned int> &version = node->version;
+  version.store(version.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+/******************************************************************************/
+/*                                 DEBUG FUNCTIONS                            */
+/******************************************************************************/
+template <typename Key, typename Value>
+void tree_to_vec(RedBlackNode<Key, Value> *node, vector<Key> &vec, vector<int> &flags) {
+  if (!node) return;
+  tree_to_vec(node->child[0].load(), vec, flags);
+  vec.push_back(node->key);
+  flags.push_back(node->flag);
+  tree_to_vec(node->child[1].load(), vec, flags);
+}
+
+template <typename Key, typename Value>
+void print_tree(RedBlackNode<Key, Value> *node) {
+  printf("---------------Printing tree---------------\n");
+  std::vector<Key> vec;
+  std::vector<int> flags;
+  tree_to_vec(node, vec, flags);
+  for (size_t i = 0; i < vec.size(); i++) {
+    cout << vec[i] << ", flag " << flags[i] << '\n';
+  }
+  printf("\n");
+}
@@ -0,0 +1,39 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include "workload.h"
+
+using namespace std;
+
+// Converts a workload (text or binary) into the binary format
+int main(int argc, char *argv[]) {
+  uint32_t key_bytes = 4;
+  int opt;
+  while ((opt = getopt(argc, argv, "w")) != -1) {
+    switch (opt) {
+      case 'w':
+        key_bytes = 8;
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [-w (int64 keys)] input_filename output_filename\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+  }
+  if (argc - optind != 2) {
+    fprintf(stderr, "Usage: %s [-w (int64 keys)] input_filename output_filename\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  Workload_t workload = workload_open(argv[optind]);
+  if (!workload) {
+    exit(EXIT_FAILURE);
+  }
+  if (!workload_write(argv[optind + 1], workload, key_bytes)) {
+    fprintf(stderr, "Unable to write file: %s.\n", argv[optind + 1]);
+    exit(EXIT_FAILURE);
+  }
+  printf("Wrote %zu runs, %zu keys.\n", workload->runs.size(), workload->num_keys);
+  workload_close(workload);
+  return 0;
+}
@@ -0,0 +1,187 @@
+#include "workload.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Adds a run of count keys starting at offset
+static void add_run(Workload_t workload, uint32_t type, uint64_t count, size_t offset) {
+  workload->runs.push_back({type, 0, count});
+  workload->offsets.push_back(offset);
+}
+
+// Fills workload from a mapped binary file, returns false if it is malformed
+static bool load_binary(Workload_t workload, const char *data, size_t bytes, const string &filename) {
+  WorkloadHeader_t header;
+  memcpy(&header, data, sizeof(header));
+  if (header.version != WORKLOAD_VERSION || (header.key_bytes != 4 && header.key_bytes != 8)) {
+    fprintf(stderr, "%s: unsupported workload version %u or key size %u\n", filename.c_str(), header.version,
+            header.key_bytes);
+    return false;
+  }
+  size_t runs_bytes = header.num_runs * sizeof(WorkloadRun_t);
+  if (header.num_runs > bytes / sizeof(WorkloadRun_t) || header.num_keys > bytes / header.key_bytes ||
+      sizeof(header) + runs_bytes + header.num_keys * header.key_bytes > bytes) {
+    fprintf(stderr, "%s: truncated workload\n", filename.c_str());
+    return false;
+  }
+
+  const WorkloadRun_t *runs = (const WorkloadRun_t *)(data + sizeof(header));
+  size_t offset = 0;
+  for (uint64_t i = 0; i < header.num_runs; i++) {
+    if (runs[i].type > WORKLOAD_LOOKUP || runs[i].count > header.num_keys - offset) {
+      fprintf(stderr, "%s: run %lu is invalid\n", filename.c_str(), (unsigned long)i);
+      return false;
+    }
+    add_run(workload, runs[i].type, runs[i].count, offset);
+    offset += runs[i].count;
+  }
+  workload->num_keys = offset;
+
+  const char *keys = data + sizeof(header) + runs_bytes;
+  if (header.key_bytes == 4) {
+    workload->keys = (const int32_t *)keys;
+    return true;
+  }
+  // The drivers' trees hold int keys, so wider keys are narrowed (and copied)
+  workload->storage.resize(offset);
+  for (size_t i = 0; i < offset; i++) {
+    int64_t key;
+    memcpy(&key, keys + 8 * i, 8);
+    if (key < INT_MIN || key > INT_MAX) {
+      fprintf(stderr, "%s: key %ld doesn't fit in an int\n", filename.c_str(), (long)key);
+      return false;
+    }
+    workload->storage[i] = key;
+  }
+  workload->keys = workload->storage.data();
+  return true;
+}
+
+// Fills workload from the text format, returns false if it is malformed
+static bool load_text(Workload_t workload, const char *text, const string &filename) {
+  const char *names[] = {"INSERT", "DELETE", "LOOKUP"};
+  const char *p = text;
+  while (true) {
+    p += strspn(p, " \t\r\n");
+    if (!*p) break;
+    size_t length = strcspn(p, " \t\r\n");
+    uint32_t type = WORKLOAD_LOOKUP + 1;
+    for (uint32_t t = WORKLOAD_INSERT; t <= WORKLOAD_LOOKUP; t++) {
+      if (length == strlen(names[t]) && !strncmp(p, names[t], length)) type = t;
+    }
+    if (type > WORKLOAD_LOOKUP) {
+      fprintf(stderr, "%s: expected INSERT, DELETE or LOOKUP, found %.*s\n", filename.c_str(), (int)length, p);
+      return false;
+    }
+    p += length;
+
+    char *end;
+    errno = 0;
+    long long count = strtoll(p, &end, 10);
+    if (end == p || count < 0 || errno) {
+      fprintf(stderr, "%s: %s without a key count\n", filename.c_str(), names[type]);
+      return false;
+    }
+    p = end;
+    add_run(workload, type, count, workload->storage.size());
+    for (long long i = 0; i < count; i++) {
+      long key = strtol(p, &end, 10);
+      if (end == p || errno || key < INT_MIN || key > INT_MAX) {
+        fprintf(stderr, "%s: %s %lld has too few keys or a key out of range\n", filename.c_str(), names[type],
+                count);
+        return false;
+      }
+      workload->storage.push_back(key);
+      p = end;
+    }
+  }
+  workload->keys = workload->storage.data();
+  workload->num_keys = workload->storage.size();
+  return true;
+}
+
+// Loads a workload in either format (told apart by the binary header's magic),
+// returns null (having said why on stderr) if it can't be read. Binary files are
+// mapped rather than read, so their int32 keys are used in place.
+Workload_t workload_open(const string &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    fprintf(stderr, "Unable to open file: %s.\n", filename.c_str());
+    if (fd >= 0) close(fd);
+    return nullptr;
+  }
+  size_t bytes = st.st_size;
+  Workload_t workload = new struct Workload();
+  workload->keys = nullptr;
+  workload->num_keys = 0;
+  workload->mapping = nullptr;
+  workload->mapping_bytes = 0;
+
+  bool loaded;
+  void *data = bytes ? mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+  if (bytes && data == MAP_FAILED) {
+    fprintf(stderr, "Unable to map file: %s.\n", filename.c_str());
+    loaded = false;
+  } else if (bytes >= sizeof(WorkloadHeader_t) && !memcmp(data, WORKLOAD_MAGIC, sizeof(WORKLOAD_MAGIC))) {
+    workload->mapping = data;
+    workload->mapping_bytes = bytes;
+    madvise(data, bytes, MADV_SEQUENTIAL);
+    loaded = load_binary(workload, (const char *)data, bytes, filename);
+  } else {
+    // strtol needs the text zero-terminated, which the mapping isn't
+    string text((const char *)data, bytes);
+    if (data) munmap(data, bytes);
+    loaded = load_text(workload, text.c_str(), filename);
+  }
+  close(fd);
+  if (!loaded) {
+    workload_close(workload);
+    return nullptr;
+  }
+  return workload;
+}
+
+void workload_close(Workload_t workload) {
+  if (workload->mapping) {
+    munmap(workload->mapping, workload->mapping_bytes);
+  }
+  delete workload;
+}
+
+// Writes workload in the binary format with keys of key_bytes (4 or 8) bytes,
+// returns false if the file can't be written
+bool workload_write(const string &filename, Workload_t workload, uint32_t key_bytes) {
+  FILE *file = fopen(filename.c_str(), "wb");
+  if (!file || (key_bytes != 4 && key_bytes != 8)) {
+    if (file) fclose(file);
+    return false;
+  }
+  WorkloadHeader_t header = {};
+  memcpy(header.magic, WORKLOAD_MAGIC, sizeof(WORKLOAD_MAGIC));
+  header.version = WORKLOAD_VERSION;
+  header.key_bytes = key_bytes;
+  header.num_runs = workload->runs.size();
+  header.num_keys = workload->num_keys;
+
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(workload->runs.data(), sizeof(WorkloadRun_t), workload->runs.size(), file) ==
+                     workload->runs.size();
+  if (key_bytes == 4) {
+    written = written && fwrite(workload->keys, 4, workload->num_keys, file) == workload->num_keys;
+  } else {
+    for (size_t i = 0; written && i < workload->num_keys; i++) {
+      int64_t key = workload->keys[i];
+      written = fwrite(&key, 8, 1, file) == 1;
+    }
+  }
+  return fclose(file) == 0 && written;
+}
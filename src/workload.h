@@ -0,0 +1,67 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/******************************************************************************/
+/*                            WORKLOAD FILES                                  */
+/******************************************************************************/
+/*   Test cases are runs of one operation type over a list of keys. The text  */
+/*   format (the .txt files in inputs) puts each run on two lines:            */
+/*       INSERT 3                                                             */
+/*       17 -4 99                                                             */
+/*   The binary format holds the same runs ready to use once mapped into      */
+/*   memory: a WorkloadHeader, then num_runs WorkloadRuns, then the keys of   */
+/*   every run one after the other, packed as int32 or int64 (key_bytes) in   */
+/*   the machine's byte order. Everything stays 8-byte aligned.               */
+/******************************************************************************/
+
+#define WORKLOAD_MAGIC "RBTWORK"
+#define WORKLOAD_VERSION 1
+
+// Operation types of runs, numbered as in the trees' drivers
+#define WORKLOAD_INSERT 0
+#define WORKLOAD_DELETE 1
+#define WORKLOAD_LOOKUP 2
+
+typedef struct WorkloadHeader {
+  // WORKLOAD_MAGIC with its terminating zero
+  char magic[8];
+  uint32_t version;
+  // 4 or 8
+  uint32_t key_bytes;
+  uint64_t num_runs;
+  uint64_t num_keys;
+} WorkloadHeader_t;
+
+typedef struct WorkloadRun {
+  uint32_t type;
+  uint32_t reserved;
+  uint64_t count;
+} WorkloadRun_t;
+
+// A loaded workload. The keys of run i start at keys + offsets[i]; they point
+// straight into the mapped file for a binary workload with int32 keys, and
+// into storage otherwise.
+typedef struct Workload {
+  vector<WorkloadRun_t> runs;
+  vector<size_t> offsets;
+  const int32_t *keys;
+  size_t num_keys;
+  // Keys parsed from text (or narrowed from int64), if not mapped
+  vector<int32_t> storage;
+  void *mapping;
+  size_t mapping_bytes;
+} *Workload_t;
+
+// Workload Functions
+Workload_t workload_open(const string &filename);
+void workload_close(Workload_t workload);
+bool workload_write(const string &filename, Workload_t workload, uint32_t key_bytes = 4);
+
+#endif